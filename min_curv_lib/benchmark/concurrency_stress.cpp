@@ -0,0 +1,236 @@
+// Stress test of the lock-free trajectory outputs: one writer publishes numbered trajectories as fast as
+// it can while several readers copy them. Trajectory k is the horizontal line y = k, so a reader that
+// sees two different y in one snapshot has read a torn one. Readers also check that the numbering only
+// moves forward and agrees with the writer's counter. The shared-memory ring additionally carries k as
+// curvature and stamp and 1 + k % kMaxRingPoints points, which must all match the index of the slot.
+// Exits with 1 on the first inconsistency.
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/cubic_spline.hpp"
+#include "min_curv_lib/trajectory_buffer.hpp"
+#include "min_curv_lib/trajectory_ring.hpp"
+
+namespace {
+
+constexpr std::size_t kNumControlPoints = 10;
+constexpr std::size_t kNumSamples = 50;
+constexpr double kTolerance = 1e-6;
+// Few slots, so readers keep losing their trajectory to the writer, and long ones, so that even on a
+// single core the writer is often preempted in the middle of a slot
+constexpr std::size_t kNumRingSlots = 4;
+constexpr std::size_t kMaxRingPoints = 4096;
+
+struct Outcome {
+    std::atomic<bool> failed{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::mutex mutex;
+    std::string message;
+
+    void fail(const std::string& reason) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!failed.exchange(true)) {
+            message = reason;
+        }
+    }
+};
+
+std::vector<Eigen::Vector2d> makeTrajectory(const std::uint64_t number) {
+    std::vector<Eigen::Vector2d> points;
+    for (std::size_t i = 0; i < kNumControlPoints; ++i) {
+        points.emplace_back(2.0 * i, static_cast<double>(number));
+    }
+    return points;
+}
+
+// TrajectoryBuffer: readers pin the current slot, the writer must never refill a pinned one
+const bool stressBuffer(const std::uint64_t num_trajectories, const std::size_t num_readers) {
+    spline::TrajectoryBuffer buffer(kNumSamples);
+    std::atomic<bool> writing{true};
+    Outcome outcome;
+
+    auto reader = [&]() {
+        std::uint64_t last_sequence = 0;
+        while (writing.load() && !outcome.failed.load()) {
+            const std::uint64_t before = buffer.sequence();
+            if (before == 0) {
+                continue;
+            }
+            const auto snapshot = buffer.read();
+            const std::uint64_t sequence = snapshot->sequence();
+            // Read every sample twice, the slot must not change while it is pinned
+            for (std::size_t pass = 0; pass < 2; ++pass) {
+                for (std::size_t i = 0; i < kNumSamples; ++i) {
+                    const double s = snapshot->length() * i / (kNumSamples - 1);
+                    if (std::abs(snapshot->sample(s).position.y() - static_cast<double>(sequence)) > kTolerance) {
+                        outcome.fail("torn snapshot " + std::to_string(sequence) + " at sample " + std::to_string(i));
+                        return;
+                    }
+                }
+            }
+            // The snapshot was current at some point after `before` was published
+            const std::uint64_t after = buffer.sequence();
+            if (sequence < before || sequence > after + 1) {
+                outcome.fail("snapshot " + std::to_string(sequence) + " outside [" + std::to_string(before) +
+                             ", " + std::to_string(after + 1) + "]");
+                return;
+            }
+            if (sequence < last_sequence) {
+                outcome.fail("sequence went back from " + std::to_string(last_sequence) + " to " + std::to_string(sequence));
+                return;
+            }
+            last_sequence = sequence;
+            outcome.reads.fetch_add(1);
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (std::size_t r = 0; r < num_readers; ++r) {
+        readers.emplace_back(reader);
+    }
+    std::uint64_t published = 0;
+    spline::ParametricCubicSpline trajectory;
+    for (std::uint64_t k = 1; k <= num_trajectories && !outcome.failed.load(); ++k) {
+        // Published trajectories are numbered by the buffer, dropped ones do not take a number
+        trajectory.setControlPoints(makeTrajectory(published + 1));
+        published += buffer.publish(trajectory, static_cast<double>(k)) ? 1 : 0;
+    }
+    writing.store(false);
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    if (!outcome.failed.load() && (buffer.sequence() != published || published + buffer.dropped() != num_trajectories)) {
+        outcome.fail("writer counted " + std::to_string(published) + " published and " + std::to_string(buffer.dropped()) +
+                     " dropped of " + std::to_string(num_trajectories) + ", sequence is " + std::to_string(buffer.sequence()));
+    }
+
+    std::cout << "buffer: " << published << " published, " << buffer.dropped() << " dropped, "
+              << outcome.reads.load() << " snapshots checked by " << num_readers << " readers";
+    std::cout << (outcome.failed.load() ? "  FAIL: " + outcome.message : "") << "\n";
+    return !outcome.failed.load();
+}
+
+// Empty if the trajectory is consistent with its index
+const std::string checkRingTrajectory(const spline::RingTrajectory& trajectory) {
+    const double value = static_cast<double>(trajectory.index);
+    if (trajectory.points.size() != 1 + trajectory.index % kMaxRingPoints || trajectory.curvature.size() != trajectory.points.size()) {
+        return "trajectory " + std::to_string(trajectory.index) + " has " + std::to_string(trajectory.points.size()) + " points";
+    }
+    if (trajectory.stamp != value) {
+        return "trajectory " + std::to_string(trajectory.index) + " has the stamp of " + std::to_string(trajectory.stamp);
+    }
+    for (std::size_t i = 0; i < trajectory.points.size(); ++i) {
+        if (trajectory.points[i].y() != value || trajectory.curvature[i] != value) {
+            return "torn trajectory " + std::to_string(trajectory.index) + " at point " + std::to_string(i);
+        }
+    }
+    return "";
+}
+
+// TrajectoryRing: per-slot seqlocks, readers must reject every slot the writer touched while they copied it
+const bool stressRing(const std::uint64_t num_trajectories, const std::size_t num_readers) {
+    const std::string name = "min_curv_stress_" + std::to_string(getpid());
+    spline::TrajectoryRingWriter writer(name, kNumRingSlots, kMaxRingPoints);
+    std::atomic<bool> writing{true};
+    std::atomic<std::uint64_t> overwritten{0};
+    std::atomic<std::size_t> ready{0};
+    Outcome outcome;
+
+    auto reader = [&]() {
+        const spline::TrajectoryRingReader ring(name);
+        spline::RingTrajectory trajectory;
+        std::uint64_t last_index = 0;
+        ready.fetch_add(1);
+        while (writing.load() && !outcome.failed.load()) {
+            const std::uint64_t before = ring.writeCount();
+            if (!ring.readLatest(trajectory)) {
+                continue;
+            }
+            const std::uint64_t after = ring.writeCount();
+            std::string reason = checkRingTrajectory(trajectory);
+            // The latest trajectory was complete at some point between the two counts
+            if (reason.empty() && (trajectory.index + 1 < before || trajectory.index >= after)) {
+                reason = "latest trajectory " + std::to_string(trajectory.index) + " outside [" + std::to_string(before) +
+                         ", " + std::to_string(after) + ")";
+            }
+            if (reason.empty() && trajectory.index < last_index) {
+                reason = "index went back from " + std::to_string(last_index) + " to " + std::to_string(trajectory.index);
+            }
+            if (!reason.empty()) {
+                outcome.fail(reason);
+                return;
+            }
+            last_index = trajectory.index;
+            outcome.reads.fetch_add(1);
+            // An older trajectory is either still intact or reported as overwritten
+            const std::uint64_t older = trajectory.index - std::min<std::uint64_t>(trajectory.index, kNumRingSlots - 1);
+            if (ring.read(older, trajectory)) {
+                reason = checkRingTrajectory(trajectory);
+                if (reason.empty() && trajectory.index != older) {
+                    reason = "asked for trajectory " + std::to_string(older) + ", got " + std::to_string(trajectory.index);
+                }
+                if (!reason.empty()) {
+                    outcome.fail(reason);
+                    return;
+                }
+                outcome.reads.fetch_add(1);
+            } else {
+                overwritten.fetch_add(1);
+            }
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (std::size_t r = 0; r < num_readers; ++r) {
+        readers.emplace_back(reader);
+    }
+    // Mapping the segment takes longer than writing a few thousand trajectories
+    while (ready.load() < num_readers) {
+        std::this_thread::yield();
+    }
+    std::vector<Eigen::Vector2d> points;
+    std::vector<double> curvature;
+    for (std::uint64_t k = 0; k < num_trajectories && !outcome.failed.load(); ++k) {
+        const std::size_t num_points = 1 + k % kMaxRingPoints;
+        points.assign(num_points, Eigen::Vector2d(0.0, static_cast<double>(k)));
+        for (std::size_t i = 0; i < num_points; ++i) {
+            points[i].x() = static_cast<double>(i);
+        }
+        curvature.assign(num_points, static_cast<double>(k));
+        writer.write(points, curvature, static_cast<double>(k));
+    }
+    writing.store(false);
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    spline::TrajectoryRingWriter::unlink(name);
+    if (!outcome.failed.load() && writer.writeCount() != num_trajectories) {
+        outcome.fail("write count is " + std::to_string(writer.writeCount()) + " after " + std::to_string(num_trajectories) + " writes");
+    }
+
+    std::cout << "ring: " << writer.writeCount() << " written, " << outcome.reads.load() << " trajectories checked and "
+              << overwritten.load() << " reported overwritten by " << num_readers << " readers";
+    std::cout << (outcome.failed.load() ? "  FAIL: " + outcome.message : "") << "\n";
+    return !outcome.failed.load();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string target = argc > 1 ? argv[1] : "";
+    if (argc < 2 || argc > 4 || (target != "buffer" && target != "ring")) {
+        std::cerr << "Usage: " << argv[0] << " buffer|ring [num_trajectories=20000] [num_readers=4]\n";
+        return 1;
+    }
+    const std::uint64_t num_trajectories = argc > 2 ? std::stoull(argv[2]) : 20000;
+    const std::size_t num_readers = argc > 3 ? std::stoul(argv[3]) : 4;
+    const bool passed = target == "buffer" ? stressBuffer(num_trajectories, num_readers) : stressRing(num_trajectories, num_readers);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// Fault handling of the ProcessDispatcher. A worker killed in the middle of a solve must be replaced and
+// its request finished by another worker, and a request that times out on every attempt must fail after
+// exactly max_retries + 1 attempts, with one worker restart per attempt and no worker left behind.
+// Exits with 1 if any check fails.
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/process_dispatcher.hpp"
+
+namespace {
+
+using spline::optimization::CorridorRequest;
+using spline::optimization::CorridorResult;
+using spline::optimization::ProcessDispatcher;
+using spline::optimization::ProcessDispatcherParams;
+
+constexpr std::size_t kNumWorkers = 3;
+constexpr std::size_t kNumControlPoints = 200;
+
+// Winding road of constant width, large enough that a worker spends tens of milliseconds on it
+CorridorRequest makeRequest(const double phase) {
+    CorridorRequest request;
+    for (std::size_t i = 0; i < kNumControlPoints; ++i) {
+        const Eigen::Vector2d point(2.0 * i, 10.0 * std::sin(0.03 * i + phase));
+        request.centerline.push_back(point);
+        request.left_boundary.push_back(point + Eigen::Vector2d(0.0, 3.0));
+        request.right_boundary.push_back(point - Eigen::Vector2d(0.0, 3.0));
+    }
+    return request;
+}
+
+std::unique_ptr<ProcessDispatcherParams> makeParams(const std::size_t max_retries, const double timeout) {
+    auto params = std::make_unique<ProcessDispatcherParams>();
+    params->num_workers = kNumWorkers;
+    params->max_retries = max_retries;
+    params->timeout = timeout;
+    params->optimizer.max_num_iterations = 4000;
+    return params;
+}
+
+// Children of parent with their state letter from /proc/<pid>/stat, e.g. R for running or runnable
+std::vector<std::pair<pid_t, char>> children(const pid_t parent) {
+    std::vector<std::pair<pid_t, char>> result;
+    DIR* proc = opendir("/proc");
+    if (proc == nullptr) {
+        return result;
+    }
+    while (const dirent* entry = readdir(proc)) {
+        const pid_t pid = static_cast<pid_t>(std::atoi(entry->d_name));
+        if (pid <= 0) {
+            continue;
+        }
+        std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+        std::string line;
+        if (!std::getline(stat, line) || line.rfind(')') == std::string::npos) {
+            continue;
+        }
+        // pid (comm) state ppid ..., comm may contain spaces
+        char state = 0;
+        pid_t ppid = 0;
+        std::istringstream fields(line.substr(line.rfind(')') + 1));
+        if (fields >> state >> ppid && ppid == parent) {
+            result.emplace_back(pid, state);
+        }
+    }
+    closedir(proc);
+    return result;
+}
+
+// Forked before the dispatcher, kills the first sibling that is busy solving. Exits with 0 once it killed one.
+pid_t startKiller() {
+    const pid_t parent = getpid();
+    const pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (const auto& child : children(parent)) {
+            if (child.first != getpid() && child.second == 'R' && kill(child.first, SIGKILL) == 0) {
+                _exit(0);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _exit(1);
+}
+
+const bool check(const bool condition, const std::string& description) {
+    std::cout << (condition ? "  ok    " : "  FAIL  ") << description << "\n";
+    return condition;
+}
+
+const bool killedWorker() {
+    std::cout << "Worker killed while solving:\n";
+    std::vector<CorridorRequest> requests;
+    for (std::size_t i = 0; i < 4 * kNumWorkers; ++i) {
+        requests.push_back(makeRequest(0.5 * i));
+    }
+    const pid_t killer = startKiller();
+    std::vector<CorridorResult> results;
+    std::size_t restarts = 0;
+    {
+        ProcessDispatcher dispatcher(makeParams(2, 0.0));
+        results = dispatcher.solve(requests);
+        restarts = dispatcher.getRestarts();
+    }
+    int status = 0;
+    waitpid(killer, &status, 0);
+    std::size_t solved = 0;
+    for (const auto& result : results) {
+        solved += result.success ? 1 : 0;
+    }
+
+    bool passed = check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "a busy worker was killed");
+    passed = check(restarts == 1, "1 worker restart (" + std::to_string(restarts) + ")") && passed;
+    passed = check(solved == requests.size(), "every request solved (" + std::to_string(solved) + "/" +
+                   std::to_string(requests.size()) + ")") && passed;
+    passed = check(children(getpid()).empty(), "no worker left behind") && passed;
+    return passed;
+}
+
+const bool timedOut() {
+    constexpr std::size_t kMaxRetries = 2;
+    constexpr std::size_t kNumRequests = 2;
+    std::cout << "Every attempt times out, max_retries = " << kMaxRetries << ":\n";
+    std::vector<CorridorRequest> requests;
+    for (std::size_t i = 0; i < kNumRequests; ++i) {
+        requests.push_back(makeRequest(0.5 * i));
+    }
+    std::vector<CorridorResult> results;
+    std::size_t restarts = 0;
+    {
+        // A millisecond is far shorter than the setUp alone
+        ProcessDispatcher dispatcher(makeParams(kMaxRetries, 1.0));
+        results = dispatcher.solve(requests);
+        restarts = dispatcher.getRestarts();
+    }
+    const std::string expected = "Worker timed out after " + std::to_string(kMaxRetries + 1) + " attempts.";
+    std::size_t failed = 0;
+    for (const auto& result : results) {
+        failed += !result.success && result.message == expected ? 1 : 0;
+    }
+
+    bool passed = check(failed == kNumRequests, "every request failed with \"" + expected + "\" (" +
+                        std::to_string(failed) + "/" + std::to_string(kNumRequests) + ")");
+    passed = check(restarts == kNumRequests * (kMaxRetries + 1), "one restart per attempt (" + std::to_string(restarts) + ")") && passed;
+    passed = check(children(getpid()).empty(), "no worker left behind") && passed;
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    // Both dispatchers fork, so nothing here starts a thread
+    const bool killed = killedWorker();
+    const bool timeouts = timedOut();
+    return killed && timeouts ? 0 : 1;
+}
@@ -0,0 +1,371 @@
+// Numerical equivalence of the optimized configurations with the reference optimizer. Every candidate
+// solves the same randomized and recorded corridors as the reference, the QP data, offsets and exact
+// curvature are checked against tolerances and the speedup on the same inputs is reported.
+// Exits with 1 if any candidate is out of tolerance.
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/cubic_spline.hpp"
+#include "min_curv_lib/curv_min.hpp"
+#include "min_curv_lib/track_io.hpp"
+
+namespace {
+
+using spline::optimization::MinCurvatureOptimizer;
+using spline::optimization::MinCurvatureParams;
+using spline::optimization::QPFormulation;
+using spline::optimization::QPProblem;
+
+constexpr std::size_t kNumControlPoints = 40;
+constexpr std::size_t kNumCurvatureSamples = 200;
+constexpr double kLastPointShrink = 0.6;
+constexpr double kNormalWeight = 0.5;
+
+struct Corridor {
+    std::vector<Eigen::Vector2d> centerline;
+    std::vector<Eigen::Vector2d> left_boundary;
+    std::vector<Eigen::Vector2d> right_boundary;
+};
+
+// Smooth random roads: curvature and widths are sums of sinusoids along the arc length
+std::vector<Corridor> makeRandomCorridors(const std::size_t num_corridors, const unsigned int seed) {
+    std::mt19937 generator(seed);
+    auto uniform = [&generator](const double min, const double max) {
+        return std::uniform_real_distribution<double>(min, max)(generator);
+    };
+    std::vector<Corridor> corridors(num_corridors);
+    for (auto& corridor : corridors) {
+        Eigen::Vector2d position(uniform(-100.0, 100.0), uniform(-100.0, 100.0));
+        double heading = uniform(-M_PI, M_PI);
+        const double step = uniform(1.0, 3.0);
+        const double amplitude[2] = {uniform(0.0, 0.1), uniform(0.0, 0.05)};
+        const double frequency[2] = {uniform(0.02, 0.1), uniform(0.1, 0.4)};
+        const double phase[2] = {uniform(0.0, 2 * M_PI), uniform(0.0, 2 * M_PI)};
+        const double width[2] = {uniform(1.5, 4.0), uniform(1.5, 4.0)};
+        const double width_variation = uniform(0.0, 1.0);
+        for (std::size_t k = 0; k < kNumControlPoints; ++k) {
+            const double s = k * step;
+            const Eigen::Vector2d normal(-std::sin(heading), std::cos(heading));
+            const double variation = width_variation * std::sin(frequency[0] * s + phase[1]);
+            corridor.centerline.push_back(position);
+            corridor.left_boundary.push_back(position + (width[0] + variation) * normal);
+            corridor.right_boundary.push_back(position - (width[1] - variation) * normal);
+            const double curvature = amplitude[0] * std::sin(frequency[0] * s + phase[0]) +
+                                     amplitude[1] * std::sin(frequency[1] * s + phase[1]);
+            heading += curvature * step;
+            position += step * Eigen::Vector2d(std::cos(heading), std::sin(heading));
+        }
+    }
+    return corridors;
+}
+
+// Windows of a closed track, paired like boundary_publisher_example does
+std::vector<Corridor> makeRecordedCorridors(const std::vector<Eigen::Vector2d>& left,
+                                            const std::vector<Eigen::Vector2d>& right,
+                                            const std::size_t num_windows) {
+    std::vector<Corridor> corridors(num_windows);
+    for (std::size_t w = 0; w < num_windows; ++w) {
+        const std::size_t right_start = w * right.size() / num_windows;
+        std::size_t left_start = 0;
+        for (std::size_t i = 1; i < left.size(); ++i) {
+            if ((left[i] - right[right_start]).norm() < (left[left_start] - right[right_start]).norm()) {
+                left_start = i;
+            }
+        }
+        for (std::size_t k = 0; k < kNumControlPoints; ++k) {
+            corridors[w].right_boundary.push_back(right[(right_start + k) % right.size()]);
+            corridors[w].left_boundary.push_back(left[(left_start + k) % left.size()]);
+            corridors[w].centerline.push_back((corridors[w].left_boundary.back() + corridors[w].right_boundary.back()) / 2);
+        }
+    }
+    return corridors;
+}
+
+// Defaults are for paths that only rearrange the computation. Paths that change what the solver
+// iterates on stop elsewhere within its tolerance, for them the objective gap is what is meaningful.
+struct Tolerances {
+    double hessian = 1e-9;    // Relative, Frobenius norm
+    double linear = 1e-9;     // Relative, Euclidean norm
+    double bounds = 1e-9;     // Constraint matrix relative, bounds absolute [m]
+    double objective = 1e-9;  // Gap on the reference objective, relative to the reference optimum
+    double solution = 1e-6;   // Lateral offsets, absolute [m]
+    double curvature = 1e-6;  // Exact curvature of the optimized spline, absolute [1/m]
+};
+
+struct Candidate {
+    std::string name;
+    std::function<void(MinCurvatureParams&)> configure;
+    Tolerances tolerances;
+    bool same_problem = true;    // Same variables as the reference, so H, c and the bounds are compared too
+    bool widths = false;         // Corridor widths instead of boundary splines
+    bool repeat = false;         // Solve each corridor twice and check the second solve, i.e. the cache hit
+    bool reuse_inverse = false;  // Constructed from the inverse of the reference, as from a TrackMap
+};
+
+struct Outcome {
+    QPProblem problem;
+    Eigen::VectorXd solution;
+    Eigen::VectorXd curvature;
+    double time = 0.0;  // setUp and solve [ms]
+};
+
+struct Errors {
+    double hessian = 0.0;
+    double linear = 0.0;
+    double bounds = 0.0;
+    double objective = 0.0;
+    double solution = 0.0;
+    double curvature = 0.0;
+    double reference_time = 0.0;
+    double time = 0.0;
+    std::size_t size_mismatches = 0;
+};
+
+const double relativeError(const Eigen::SparseMatrix<double>& value, const Eigen::SparseMatrix<double>& reference) {
+    return (value - reference).norm() / std::max(reference.norm(), 1e-12);
+}
+
+const double relativeError(const Eigen::VectorXd& value, const Eigen::VectorXd& reference) {
+    return (value - reference).norm() / std::max(reference.norm(), 1e-12);
+}
+
+std::unique_ptr<MinCurvatureParams> makeParams() {
+    auto params = std::make_unique<MinCurvatureParams>();
+    params->num_control_points = kNumControlPoints;
+    params->num_points_evaluate = 5 * kNumControlPoints;
+    params->num_nearest = 10;
+    params->shrink = 0.2;
+    // Tight enough that where OSQP stops says little about the path that got it there
+    params->max_num_iterations = 20000;
+    params->eps_abs = 1e-6;
+    params->eps_rel = 1e-6;
+    return params;
+}
+
+// Distance from origin along direction to the first crossing of the polyline, infinite if there is none
+const double rayDistance(const Eigen::Vector2d& origin, const Eigen::Vector2d& direction,
+                         const std::vector<Eigen::Vector2d>& polyline) {
+    double distance = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i + 1 < polyline.size(); ++i) {
+        const Eigen::Vector2d segment = polyline[i + 1] - polyline[i];
+        const double denominator = direction.x() * segment.y() - direction.y() * segment.x();
+        if (std::abs(denominator) < 1e-12) {
+            continue;
+        }
+        const Eigen::Vector2d offset = polyline[i] - origin;
+        const double t = (offset.x() * segment.y() - offset.y() * segment.x()) / denominator;
+        const double along = (offset.x() * direction.y() - offset.y() * direction.x()) / denominator;
+        if (t >= 0.0 && along >= 0.0 && along <= 1.0) {
+            distance = std::min(distance, t);
+        }
+    }
+    return distance;
+}
+
+// Widths measured on the corridor itself, independently of the reference's bounds: distance along the
+// centerline normal to the boundary polylines, the nearest boundary vertex where the ray misses
+const Eigen::MatrixXd measureWidths(const Corridor& corridor) {
+    const spline::ParametricCubicSpline centerline(corridor.centerline);
+    const auto coefficients = centerline.getCoefficients();
+    const std::size_t num_points = corridor.centerline.size();
+    Eigen::MatrixXd widths(num_points, 2);
+    for (std::size_t i = 0; i < num_points; ++i) {
+        const Eigen::Vector2d normal = Eigen::Vector2d(-coefficients.second(1, i), coefficients.first(1, i)).normalized();
+        const std::vector<Eigen::Vector2d>* boundaries[2] = {&corridor.left_boundary, &corridor.right_boundary};
+        for (std::size_t side = 0; side < 2; ++side) {
+            double width = rayDistance(corridor.centerline[i], side == 0 ? normal : -normal, *boundaries[side]);
+            if (!std::isfinite(width)) {
+                width = std::numeric_limits<double>::infinity();
+                for (const auto& point : *boundaries[side]) {
+                    width = std::min(width, (point - corridor.centerline[i]).norm());
+                }
+            }
+            widths(i, side) = width;
+        }
+    }
+    return widths;
+}
+
+Outcome run(MinCurvatureOptimizer& optimizer, const Corridor& corridor, const Eigen::MatrixXd* widths) {
+    auto ref_spline = std::make_shared<spline::ParametricCubicSpline>(corridor.centerline);
+    if (widths != nullptr) {
+        optimizer.setCorridor(ref_spline, *widths);
+    } else {
+        optimizer.setSplines(ref_spline,
+                             std::make_shared<spline::ParametricCubicSpline>(corridor.left_boundary),
+                             std::make_shared<spline::ParametricCubicSpline>(corridor.right_boundary));
+    }
+    std::shared_ptr<spline::BaseCubicSpline> opt_traj = std::make_shared<spline::ParametricCubicSpline>();
+    const auto start = std::chrono::high_resolution_clock::now();
+    optimizer.setUp(kLastPointShrink);
+    optimizer.solve(opt_traj, kNormalWeight);
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    Outcome outcome;
+    outcome.problem = optimizer.getProblem();
+    outcome.solution = optimizer.getSolution();
+    outcome.time = std::chrono::duration<double, std::milli>(end - start).count();
+    outcome.curvature.resize(kNumCurvatureSamples + 1);
+    for (std::size_t i = 0; i <= kNumCurvatureSamples; ++i) {
+        outcome.curvature(i) = opt_traj->computeCurvature(static_cast<double>(i) / kNumCurvatureSamples);
+    }
+    return outcome;
+}
+
+Errors compare(const std::vector<Corridor>& corridors, const std::vector<Outcome>& reference,
+               const Eigen::MatrixXd& system_inverse, const Candidate& candidate) {
+    auto params = makeParams();
+    candidate.configure(*params);
+    auto optimizer = candidate.reuse_inverse
+                         ? std::make_unique<MinCurvatureOptimizer>(std::move(params), system_inverse)
+                         : std::make_unique<MinCurvatureOptimizer>(std::move(params));
+
+    Errors errors;
+    for (std::size_t i = 0; i < corridors.size(); ++i) {
+        const Eigen::MatrixXd widths = candidate.widths ? measureWidths(corridors[i]) : Eigen::MatrixXd();
+        const Eigen::MatrixXd* corridor_widths = candidate.widths ? &widths : nullptr;
+        Outcome outcome = run(*optimizer, corridors[i], corridor_widths);
+        if (candidate.repeat) {
+            outcome = run(*optimizer, corridors[i], corridor_widths);
+        }
+        errors.reference_time += reference[i].time;
+        errors.time += outcome.time;
+
+        if (outcome.solution.size() != reference[i].solution.size()) {
+            ++errors.size_mismatches;
+            continue;
+        }
+        const QPProblem& expected = reference[i].problem;
+        auto objective = [&expected](const Eigen::VectorXd& x) {
+            return 0.5 * x.dot(expected.P * x) + expected.q.dot(x);
+        };
+        const double optimum = objective(reference[i].solution);
+        errors.objective = std::max(errors.objective,
+                                    std::abs(objective(outcome.solution) - optimum) / std::max(std::abs(optimum), 1e-12));
+        errors.solution = std::max(errors.solution, (outcome.solution - reference[i].solution).cwiseAbs().maxCoeff());
+        errors.curvature = std::max(errors.curvature, (outcome.curvature - reference[i].curvature).cwiseAbs().maxCoeff());
+        // A cache hit skips the assembly, so there is no problem of its own to compare
+        if (!candidate.same_problem || candidate.repeat) {
+            continue;
+        }
+        const QPProblem& actual = outcome.problem;
+        if (actual.P.rows() != expected.P.rows() || actual.A.rows() != expected.A.rows()) {
+            ++errors.size_mismatches;
+            continue;
+        }
+        errors.hessian = std::max(errors.hessian, relativeError(actual.P, expected.P));
+        errors.linear = std::max(errors.linear, relativeError(actual.q, expected.q));
+        errors.bounds = std::max({errors.bounds, relativeError(actual.A, expected.A),
+                                  (actual.lower_bound - expected.lower_bound).cwiseAbs().maxCoeff(),
+                                  (actual.upper_bound - expected.upper_bound).cwiseAbs().maxCoeff()});
+    }
+    return errors;
+}
+
+const bool withinTolerances(const Errors& errors, const Tolerances& tolerances) {
+    return errors.size_mismatches == 0 && errors.hessian <= tolerances.hessian && errors.linear <= tolerances.linear &&
+           errors.bounds <= tolerances.bounds && errors.objective <= tolerances.objective &&
+           errors.solution <= tolerances.solution &&
+           errors.curvature <= tolerances.curvature;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " [<left_boundary.txt> <right_boundary.txt>] [num_corridors=20] [seed=1]\n";
+        return 1;
+    }
+    const bool recorded = argc >= 3;
+    const std::size_t num_corridors = argc > 3 ? std::stoul(argv[3]) : 20;
+    const unsigned int seed = argc > 4 ? std::stoul(argv[4]) : 1;
+
+    std::vector<std::pair<std::string, std::vector<Corridor>>> corridor_sets = {
+        {"random", makeRandomCorridors(num_corridors, seed)}};
+    if (recorded) {
+        const auto left = spline::resamplePolyline(spline::loadPoints(argv[1]), 400);
+        const auto right = spline::resamplePolyline(spline::loadPoints(argv[2]), 400);
+        corridor_sets.emplace_back("recorded", makeRecordedCorridors(left, right, num_corridors));
+    }
+
+    // OSQP stops within eps_abs = eps_rel = 1e-3, so paths that start or iterate differently only agree to that
+    Tolerances solver_tolerances;
+    solver_tolerances.objective = 1e-3;
+    solver_tolerances.solution = 0.15;
+    solver_tolerances.curvature = 0.1;
+
+    // New fast paths go here, the reference is the plain dense formulation
+    std::vector<Candidate> candidates(6);
+    candidates[0].name = "constant_system_matrix";
+    candidates[0].configure = [](MinCurvatureParams& params) { params.constant_system_matrix = true; };
+    candidates[1].name = "precomputed_inverse";
+    candidates[1].configure = candidates[0].configure;
+    candidates[1].reuse_inverse = true;
+    // Widths measured along the normals, while the reference takes the distance to the nearest boundary
+    // samples. Both agree to a few cm on smooth roads but up to ~0.4 m at hairpins, so the check is geometric.
+    candidates[2].name = "corridor_widths";
+    candidates[2].configure = [](MinCurvatureParams&) {};
+    candidates[2].widths = true;
+    candidates[2].tolerances.bounds = 0.5;
+    candidates[2].tolerances.objective = 1e-2;
+    candidates[2].tolerances.solution = 0.2;
+    candidates[2].tolerances.curvature = 0.1;
+    candidates[3].name = "cache_hit";
+    candidates[3].configure = [](MinCurvatureParams& params) { params.use_cache = true; };
+    candidates[3].repeat = true;
+    candidates[4].name = "sparse";
+    candidates[4].configure = [](MinCurvatureParams& params) { params.formulation = QPFormulation::SparseSpline; };
+    candidates[4].tolerances = solver_tolerances;
+    candidates[4].same_problem = false;
+    // Exact where it applies, so it is held to the reference only as tightly as OSQP solved that
+    candidates[5].name = "unconstrained_fast_path";
+    candidates[5].configure = [](MinCurvatureParams& params) { params.unconstrained_fast_path = true; };
+    candidates[5].tolerances = solver_tolerances;
+
+    bool passed = true;
+    std::cout << std::setw(10) << "corridors" << std::setw(24) << "candidate" << std::setw(11) << "H" << std::setw(11) << "c"
+              << std::setw(11) << "bounds" << std::setw(11) << "objective" << std::setw(11) << "offset[m]" << std::setw(11) << "k[1/m]"
+              << std::setw(10) << "ref[ms]" << std::setw(10) << "opt[ms]" << std::setw(9) << "speedup" << "\n";
+    for (const auto& corridor_set : corridor_sets) {
+        const auto& corridors = corridor_set.second;
+        MinCurvatureOptimizer reference_optimizer(makeParams());
+        std::vector<Outcome> reference;
+        for (const auto& corridor : corridors) {
+            reference.push_back(run(reference_optimizer, corridor, nullptr));
+        }
+        // Uniform inverse for the candidate that skips the factorization
+        MinCurvatureOptimizer inverse_optimizer([] {
+            auto params = makeParams();
+            params->constant_system_matrix = true;
+            return params;
+        }());
+        const Eigen::MatrixXd system_inverse = inverse_optimizer.getSystemMatrixInverse();
+
+        for (const auto& candidate : candidates) {
+            const Errors errors = compare(corridors, reference, system_inverse, candidate);
+            const bool ok = withinTolerances(errors, candidate.tolerances);
+            passed = passed && ok;
+            std::cout << std::setw(10) << corridor_set.first << std::setw(24) << candidate.name
+                      << std::scientific << std::setprecision(2)
+                      << std::setw(11) << errors.hessian << std::setw(11) << errors.linear
+                      << std::setw(11) << errors.bounds << std::setw(11) << errors.objective
+                      << std::setw(11) << errors.solution
+                      << std::setw(11) << errors.curvature
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(10) << errors.reference_time / corridors.size()
+                      << std::setw(10) << errors.time / corridors.size()
+                      << std::setw(8) << std::setprecision(2) << errors.reference_time / errors.time << "x"
+                      << (ok ? "" : "  FAIL") << (errors.size_mismatches > 0 ? " (size mismatch)" : "") << "\n";
+        }
+    }
+    std::cout << (passed ? "All candidates match the reference.\n" : "Some candidates are out of tolerance.\n");
+    return passed ? 0 : 1;
+}
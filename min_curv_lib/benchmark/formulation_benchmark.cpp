@@ -0,0 +1,254 @@
+// Latency and curvature quality of the QP formulations on windows of a recorded track, optionally
+// with hardware counters per stage
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/cubic_spline.hpp"
+#include "min_curv_lib/cubic_b_spline.hpp"
+#include "min_curv_lib/curv_min.hpp"
+#include "min_curv_lib/track_io.hpp"
+#include "perf_counters.hpp"
+
+namespace {
+
+using spline::benchmark::CounterValues;
+using spline::benchmark::PerfCounters;
+using spline::benchmark::ScopedCounters;
+
+constexpr std::size_t kNumCurvatureSamples = 100;
+constexpr std::size_t kNumEvaluationSamples = 2000;
+constexpr std::size_t kMaxIterations = 4000;
+
+struct Corridor {
+    std::vector<Eigen::Vector2d> centerline;
+    std::vector<Eigen::Vector2d> left_boundary;
+    std::vector<Eigen::Vector2d> right_boundary;
+};
+
+// Windows of a closed track, paired like boundary_publisher_example does
+std::vector<Corridor> makeCorridors(const std::vector<Eigen::Vector2d>& left,
+                                    const std::vector<Eigen::Vector2d>& right,
+                                    const std::size_t window_size,
+                                    const std::size_t num_windows) {
+    std::vector<Corridor> corridors(num_windows);
+    for (std::size_t w = 0; w < num_windows; ++w) {
+        const std::size_t right_start = w * right.size() / num_windows;
+        std::size_t left_start = 0;
+        for (std::size_t i = 1; i < left.size(); ++i) {
+            if ((left[i] - right[right_start]).norm() < (left[left_start] - right[right_start]).norm()) {
+                left_start = i;
+            }
+        }
+        for (std::size_t k = 0; k < window_size; ++k) {
+            corridors[w].right_boundary.push_back(right[(right_start + k) % right.size()]);
+            corridors[w].left_boundary.push_back(left[(left_start + k) % left.size()]);
+            corridors[w].centerline.push_back((corridors[w].left_boundary.back() + corridors[w].right_boundary.back()) / 2);
+        }
+    }
+    return corridors;
+}
+
+struct Result {
+    double setup_time = 0.0;     // [ms]
+    double solve_time = 0.0;     // [ms]
+    double mean_curvature = 0.0; // Mean squared curvature [1/m^2]
+    double max_curvature = 0.0;  // [1/m]
+    // Summed over all corridors
+    CounterValues setup_counters;
+    CounterValues solve_counters;
+    CounterValues evaluate_counters;
+    std::size_t num_control_points = 0;
+    std::size_t num_evaluated_points = 0;
+    double iterations = 0.0;           // Mean OSQP iterations
+    std::size_t capped = 0;            // Solves stopped by max_num_iterations
+};
+
+struct Mode {
+    std::string name;
+    spline::optimization::QPFormulation formulation;
+};
+
+Result run(const std::vector<Corridor>& corridors, const Mode& mode, PerfCounters* counters) {
+    auto params = std::make_unique<spline::optimization::MinCurvatureParams>();
+    params->formulation = mode.formulation;
+    params->num_control_points = corridors.front().centerline.size();
+    params->constant_system_matrix = true;
+    params->num_points_evaluate = 5 * params->num_control_points;
+    params->num_nearest = 10;
+    params->shrink = 0.2;
+    params->max_num_iterations = kMaxIterations;
+    spline::optimization::MinCurvatureOptimizer optimizer(std::move(params));
+
+    Result result;
+    for (const auto& corridor : corridors) {
+        auto ref_spline = std::make_shared<spline::ParametricCubicSpline>(corridor.centerline);
+        auto left_spline = std::make_shared<spline::ParametricCubicSpline>(corridor.left_boundary);
+        auto right_spline = std::make_shared<spline::ParametricCubicSpline>(corridor.right_boundary);
+        std::shared_ptr<spline::BaseCubicSpline> opt_traj = std::make_shared<spline::ParametricCubicSpline>();
+        optimizer.setSplines(ref_spline, left_spline, right_spline);
+
+        {
+            ScopedCounters scoped(counters, result.setup_counters);
+            const auto start = std::chrono::high_resolution_clock::now();
+            optimizer.setUp(0.6);
+            const auto end = std::chrono::high_resolution_clock::now();
+            result.setup_time += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        {
+            ScopedCounters scoped(counters, result.solve_counters);
+            const auto start = std::chrono::high_resolution_clock::now();
+            // Same effective weight as the two pass scheme of the ROS wrapper
+            optimizer.solve(opt_traj, 0.5);
+            const auto end = std::chrono::high_resolution_clock::now();
+            result.solve_time += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        result.iterations += optimizer.getIterations();
+        result.capped += optimizer.getIterations() >= kMaxIterations ? 1 : 0;
+        result.num_control_points += corridor.centerline.size();
+
+        // Exact curvature of the optimized spline, whatever the objective approximated
+        ScopedCounters scoped(counters, result.evaluate_counters);
+        for (std::size_t i = 0; i <= kNumCurvatureSamples; ++i) {
+            const double curvature = opt_traj->computeCurvature(static_cast<double>(i) / kNumCurvatureSamples);
+            result.mean_curvature += curvature * curvature / (kNumCurvatureSamples + 1);
+            result.max_curvature = std::max(result.max_curvature, curvature);
+        }
+        result.num_evaluated_points += kNumCurvatureSamples + 1;
+    }
+    result.setup_time /= corridors.size();
+    result.solve_time /= corridors.size();
+    result.iterations /= corridors.size();
+    result.mean_curvature /= corridors.size();
+    return result;
+}
+
+// Position and curvature of both spline types through the same centerlines, u in [0, 1) as the
+// B-spline basis is not defined at u = 1
+struct EvaluatorResult {
+    double time = 0.0;  // Per point [ns]
+    CounterValues counters;
+    std::size_t num_points = 0;
+};
+
+template <typename Spline>
+EvaluatorResult runEvaluator(const std::vector<Corridor>& corridors, PerfCounters* counters) {
+    EvaluatorResult result;
+    double checksum = 0.0;
+    for (const auto& corridor : corridors) {
+        const Spline spline(corridor.centerline);
+        ScopedCounters scoped(counters, result.counters);
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < kNumEvaluationSamples; ++i) {
+            const double u = static_cast<double>(i) / kNumEvaluationSamples;
+            checksum += spline.evaluateSpline(u, 0).sum() + spline.computeCurvature(u);
+        }
+        const auto end = std::chrono::high_resolution_clock::now();
+        result.time += std::chrono::duration<double, std::nano>(end - start).count();
+        result.num_points += kNumEvaluationSamples;
+    }
+    // Keeps the loop from being optimized away
+    if (!std::isfinite(checksum)) {
+        std::cerr << "Non-finite spline evaluation\n";
+    }
+    result.time /= std::max<std::size_t>(result.num_points, 1);
+    return result;
+}
+
+void printCounters(const std::string& label, const CounterValues& values, const std::size_t num_points) {
+    auto print = [](const double value) {
+        if (value < 0.0) {
+            std::cout << std::setw(14) << "n/a";
+        } else {
+            std::cout << std::setw(14) << std::fixed << std::setprecision(3) << value;
+        }
+    };
+    std::cout << std::setw(26) << label;
+    print(values.perPoint(CounterValues::Cycles, num_points));
+    print(values.ipc());
+    print(values.perPoint(CounterValues::CacheMisses, num_points));
+    print(values.perPoint(CounterValues::BranchMisses, num_points));
+    std::cout << "\n";
+}
+
+void printCounterHeader(const std::string& unit) {
+    std::cout << std::setw(26) << "stage" << std::setw(14) << "cycles/" + unit << std::setw(14) << "IPC"
+              << std::setw(14) << "cmiss/" + unit << std::setw(14) << "bmiss/" + unit << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // --counters may appear anywhere, the remaining arguments are positional
+    const int num_args = argc;
+    argc = std::remove(argv + 1, argv + argc, std::string("--counters")) - argv;
+    const bool use_counters = argc != num_args;
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <left_boundary.txt> <right_boundary.txt> [num_windows=50] [--counters]\n";
+        return 1;
+    }
+    std::unique_ptr<PerfCounters> counters;
+    if (use_counters) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->available()) {
+            std::cerr << "Hardware counters are not available (perf_event_open failed), timing only.\n";
+            counters.reset();
+        }
+    }
+    const std::size_t num_windows = argc > 3 ? std::stoul(argv[3]) : 50;
+    const auto left = spline::resamplePolyline(spline::loadPoints(argv[1]), 400);
+    const auto right = spline::resamplePolyline(spline::loadPoints(argv[2]), 400);
+
+    const std::vector<Mode> modes = {
+        {"dense", spline::optimization::QPFormulation::DenseSpline},
+        {"sparse", spline::optimization::QPFormulation::SparseSpline},
+        {"discrete", spline::optimization::QPFormulation::DiscreteCurvature}};
+
+    std::vector<std::pair<std::string, Result>> results;
+    std::cout << std::setw(10) << "N" << std::setw(11) << "mode" << std::setw(12) << "setup[ms]"
+              << std::setw(12) << "solve[ms]" << std::setw(10) << "iters" << std::setw(8) << "capped"
+              << std::setw(14) << "mean k^2" << std::setw(12) << "max k" << "\n";
+    for (const std::size_t window_size : {20, 50, 100}) {
+        const auto corridors = makeCorridors(left, right, window_size, num_windows);
+        for (const auto& mode : modes) {
+            const Result result = run(corridors, mode, counters.get());
+            results.emplace_back(std::to_string(window_size) + " " + mode.name, result);
+            std::cout << std::setw(10) << window_size << std::setw(11) << mode.name
+                      << std::setw(12) << std::fixed << std::setprecision(3) << result.setup_time
+                      << std::setw(12) << result.solve_time
+                      << std::setw(10) << std::setprecision(1) << result.iterations
+                      << std::setw(8) << result.capped
+                      << std::setw(14) << std::scientific << std::setprecision(3) << result.mean_curvature
+                      << std::setw(12) << std::fixed << result.max_curvature << "\n";
+        }
+    }
+
+    // Spline evaluators on the centerlines of the largest windows
+    const auto corridors = makeCorridors(left, right, 100, num_windows);
+    const EvaluatorResult parametric = runEvaluator<spline::ParametricCubicSpline>(corridors, counters.get());
+    const EvaluatorResult b_spline = runEvaluator<spline::CubicBSpline>(corridors, counters.get());
+    std::cout << "\n" << std::setw(26) << "evaluator" << std::setw(12) << "ns/point" << "\n"
+              << std::setw(26) << "parametric" << std::setw(12) << std::setprecision(1) << parametric.time << "\n"
+              << std::setw(26) << "b_spline" << std::setw(12) << b_spline.time << "\n";
+
+    if (!counters) {
+        return 0;
+    }
+    // Setup and solve per control point, evaluation per evaluated point
+    std::cout << "\n";
+    printCounterHeader("pt");
+    for (const auto& result : results) {
+        printCounters(result.first + " setup", result.second.setup_counters, result.second.num_control_points);
+        printCounters(result.first + " solve", result.second.solve_counters, result.second.num_control_points);
+        printCounters(result.first + " evaluate", result.second.evaluate_counters, result.second.num_evaluated_points);
+    }
+    printCounters("parametric evaluator", parametric.counters, parametric.num_points);
+    printCounters("b_spline evaluator", b_spline.counters, b_spline.num_points);
+    return 0;
+}
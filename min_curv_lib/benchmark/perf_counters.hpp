@@ -0,0 +1,131 @@
+// Hardware performance counters for the benchmarks, through perf_event_open on Linux. Counters that
+// cannot be opened (other platforms, containers, perf_event_paranoid > 2, VMs without a PMU) read as
+// unavailable and the benchmark falls back to wall-clock timing only.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace spline {
+namespace benchmark {
+
+struct CounterValues {
+    enum Counter { Cycles, Instructions, CacheMisses, BranchMisses, NumCounters };
+
+    std::array<std::uint64_t, NumCounters> counts = {};
+    std::array<bool, NumCounters> valid = {};
+
+    const double ipc() const {
+        return valid[Cycles] && valid[Instructions] && counts[Cycles] > 0
+                   ? static_cast<double>(counts[Instructions]) / counts[Cycles] : -1.0;
+    }
+    // Negative if the counter is unavailable
+    const double perPoint(const Counter counter, const std::size_t num_points) const {
+        return valid[counter] && num_points > 0 ? static_cast<double>(counts[counter]) / num_points : -1.0;
+    }
+};
+
+// One group of counters for the calling thread, user space only so that perf_event_paranoid = 2 suffices
+class PerfCounters {
+public:
+    PerfCounters() {
+#ifdef __linux__
+        const std::array<std::uint64_t, CounterValues::NumCounters> configs = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (std::size_t i = 0; i < configs.size(); ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = leader_ < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // A counter the PMU does not support is skipped, the others still count
+            file_descriptors_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+            if (leader_ < 0 && file_descriptors_[i] >= 0) {
+                leader_ = file_descriptors_[i];
+            }
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (const int file_descriptor : file_descriptors_) {
+            if (file_descriptor >= 0) {
+                close(file_descriptor);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    const bool available() const {
+        return leader_ >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        if (leader_ >= 0) {
+            ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    // Adds the counts since start() to values
+    void stop(CounterValues& values) {
+#ifdef __linux__
+        if (leader_ < 0) {
+            return;
+        }
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (std::size_t i = 0; i < file_descriptors_.size(); ++i) {
+            std::uint64_t count = 0;
+            if (file_descriptors_[i] >= 0 &&
+                read(file_descriptors_[i], &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {
+                values.counts[i] += count;
+                values.valid[i] = true;
+            }
+        }
+#else
+        (void)values;
+#endif
+    }
+
+private:
+    std::array<int, CounterValues::NumCounters> file_descriptors_ = {-1, -1, -1, -1};
+    int leader_ = -1;
+};
+
+// Starts the counters if there are any, stops them into values when it goes out of scope
+class ScopedCounters {
+public:
+    ScopedCounters(PerfCounters* counters, CounterValues& values) : counters_(counters), values_(values) {
+        if (counters_ != nullptr) {
+            counters_->start();
+        }
+    }
+    ~ScopedCounters() {
+        if (counters_ != nullptr) {
+            counters_->stop(values_);
+        }
+    }
+
+private:
+    PerfCounters* counters_;
+    CounterValues& values_;
+};
+
+} // namespace benchmark
+} // namespace spline
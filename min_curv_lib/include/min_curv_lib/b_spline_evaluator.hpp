@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include <Eigen/Dense>
+
+namespace spline {
+
+// Header-only evaluator for the clamped cubic B-splines the optimizer produces, for consumers of the
+// compact trajectory topic that should not link the library. Same knots and parameterization as
+// CubicBSpline: for n control points 0 0 0 0 1/(n-3) ... (n-4)/(n-3) 1 1 1 1, u from 0 to 1.
+// Evaluation is de Boor's algorithm on the four control points of the knot span. Unlike CubicBSpline,
+// u = 1 belongs to the last span and gives the last control point.
+class BSplineEvaluator {
+public:
+    BSplineEvaluator(const std::vector<Eigen::Vector2d>& control_points) : control_points_(control_points) {
+        initialize();
+    }
+
+    // Coordinate arrays as carried by min_curv_msgs/BSplineTrajectory
+    BSplineEvaluator(const std::vector<double>& x, const std::vector<double>& y) {
+        if (x.size() != y.size()) {
+            throw std::invalid_argument("There must be as many x as y coordinates.");
+        }
+        control_points_.reserve(x.size());
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            control_points_.emplace_back(x[i], y[i]);
+        }
+        initialize();
+    }
+
+    // Point or derivative with respect to u (derivative_order 0 to 3), u is clamped to [0, 1]
+    const Eigen::Vector2d evaluate(const double u, const std::size_t derivative_order = 0) const {
+        if (derivative_order > kDegree) {
+            return Eigen::Vector2d::Zero();
+        }
+        const double t = std::min(1.0, std::max(0.0, u));
+        const std::size_t span = findSpan(t);
+        Eigen::Vector2d points[kDegree + 1];
+        for (std::size_t j = 0; j <= kDegree; ++j) {
+            points[j] = control_points_[span - kDegree + j];
+        }
+        // Control points of the derivative, computed in place for this span
+        for (std::size_t r = 1; r <= derivative_order; ++r) {
+            for (std::size_t j = kDegree; j >= r; --j) {
+                const double spacing = knots_[span + 1 + j - r] - knots_[span - kDegree + j];
+                points[j] = (kDegree - r + 1) * (points[j] - points[j - 1]) / spacing;
+            }
+        }
+        // De Boor on the remaining degree
+        const std::size_t degree = kDegree - derivative_order;
+        for (std::size_t r = 1; r <= degree; ++r) {
+            for (std::size_t j = kDegree; j >= derivative_order + r; --j) {
+                const std::size_t i = j - derivative_order;
+                const double left = knots_[span - degree + i];
+                const double alpha = (t - left) / (knots_[span + 1 + i - r] - left);
+                points[j] = (1.0 - alpha) * points[j - 1] + alpha * points[j];
+            }
+        }
+        return points[kDegree];
+    }
+
+    // Signed curvature, positive to the left [1/m]
+    const double curvature(const double u) const {
+        const Eigen::Vector2d first = evaluate(u, 1);
+        const Eigen::Vector2d second = evaluate(u, 2);
+        return (first.x() * second.y() - first.y() * second.x()) / std::pow(first.squaredNorm(), 1.5);
+    }
+
+    // Points at num_samples evenly spaced parameters from 0 to 1, both included
+    const std::vector<Eigen::Vector2d> sample(const std::size_t num_samples) const {
+        std::vector<Eigen::Vector2d> points(num_samples);
+        for (std::size_t i = 0; i < num_samples; ++i) {
+            points[i] = evaluate(num_samples > 1 ? static_cast<double>(i) / (num_samples - 1) : 0.0);
+        }
+        return points;
+    }
+
+    const std::vector<Eigen::Vector2d>& getControlPoints() const {
+        return control_points_;
+    }
+
+private:
+    static constexpr std::size_t kDegree = 3;
+
+    void initialize() {
+        const std::size_t n = control_points_.size();
+        if (n <= kDegree) {
+            throw std::invalid_argument("A cubic B-spline needs at least 4 control points.");
+        }
+        knots_.assign(n + kDegree + 1, 0.0);
+        for (std::size_t i = kDegree + 1; i < n; ++i) {
+            knots_[i] = static_cast<double>(i - kDegree) / (n - kDegree);
+        }
+        for (std::size_t i = n; i < knots_.size(); ++i) {
+            knots_[i] = 1.0;
+        }
+    }
+
+    // Index k of the knot span [knots_k, knots_k+1) containing u, the last span also holds u = 1
+    const std::size_t findSpan(const double u) const {
+        const std::size_t n = control_points_.size();
+        const std::size_t num_spans = n - kDegree;
+        const std::size_t span = static_cast<std::size_t>(u * num_spans);
+        return kDegree + std::min(span, num_spans - 1);
+    }
+
+    std::vector<Eigen::Vector2d> control_points_;
+    std::vector<double> knots_;
+};
+} // namespace spline
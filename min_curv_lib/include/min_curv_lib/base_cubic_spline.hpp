@@ -16,8 +16,10 @@ public:
     virtual const double computeCurvature(const double u) const = 0;
     const size_t size() const;
     const size_t& degree() const;
-    void setControlPoints(const std::vector<Eigen::Vector2d>& control_points);
+    virtual void setControlPoints(const std::vector<Eigen::Vector2d>& control_points);
     const std::vector<Eigen::Vector2d>& getControlPoints() const;
+    // Parameter length of each segment, uniform unless the spline supports non-uniform knots
+    virtual const Eigen::VectorXd getParameterSpacing() const;
 
     virtual const std::pair<Eigen::MatrixXd, Eigen::MatrixXd> getCoefficients() const = 0;
 
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <limits>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/curv_min.hpp"
+
+namespace spline {
+namespace optimization {
+
+struct CorridorRequest
+{
+    std::vector<Eigen::Vector2d> centerline;
+    std::vector<Eigen::Vector2d> left_boundary;
+    std::vector<Eigen::Vector2d> right_boundary;
+    double weight = 0.5;
+    double last_point_shrink = 0.5;
+};
+
+struct CorridorResult
+{
+    bool success = false;                         // OSQP solved the request, see MinCurvatureOptimizer::getStatus
+    std::string message;
+    std::vector<Eigen::Vector2d> control_points;  // Optimized control points, also the last iterate if OSQP stopped early
+    std::size_t batch_size = 0;                   // Number of requests solved together
+    double queue_time = 0.0;                      // Time spent waiting for the batch [ms]
+    double setup_time = 0.0;                      // Time spent in setUp [ms]
+    double solve_time = 0.0;                      // Time spent in solve [ms]
+};
+
+struct CandidateResult
+{
+    bool success = false;                         // OSQP solved the candidate
+    SolveStatus status = SolveStatus::Failed;
+    std::string message;
+    std::vector<Eigen::Vector2d> control_points;  // Optimized control points
+    double objective = std::numeric_limits<double>::infinity();  // 1/2 x'Hx + c'x of the lateral offsets x, infinite unless solved
+    double reference_time = 0.0;                  // Shared reference setup, the same for every candidate [ms]
+    double setup_time = 0.0;                      // Bounds of this candidate [ms]
+    double solve_time = 0.0;                      // [ms]
+};
+
+struct BatchOptimizerParams
+{
+    std::size_t num_threads = 4;
+    std::size_t max_batch_size = 16;
+    double batch_window = 5.0;  // Coalescing window [ms]
+    MinCurvatureParams optimizer;
+
+    BatchOptimizerParams() = default;
+    BatchOptimizerParams(std::size_t num_threads,
+                         std::size_t max_batch_size,
+                         double batch_window,
+                         const MinCurvatureParams& optimizer)
+        : num_threads(num_threads), max_batch_size(max_batch_size),
+          batch_window(batch_window), optimizer(optimizer) {}
+};
+
+class BatchOptimizer {
+public:
+    BatchOptimizer();
+    BatchOptimizer(std::unique_ptr<BatchOptimizerParams> params);
+    ~BatchOptimizer();
+
+    // Queue a request; requests arriving within the batch window are solved together
+    std::future<CorridorResult> submit(const CorridorRequest& request);
+    // Solve a set of requests right away, spread across the worker threads
+    std::vector<CorridorResult> solveBatch(const std::vector<CorridorRequest>& requests);
+    // Solve several candidate corridors around one reference, e.g. for overtaking or a pit lane entry.
+    // Normals, H and c are computed once, the candidates only differ in their bounds. Dense formulation.
+    std::vector<CandidateResult> solveCandidates(const std::shared_ptr<BaseCubicSpline>& ref_spline,
+                                                 const std::vector<CandidateCorridor>& candidates,
+                                                 const double last_point_shrink = 0.5);
+
+private:
+    struct PendingRequest {
+        CorridorRequest request;
+        std::promise<CorridorResult> promise;
+        std::chrono::high_resolution_clock::time_point arrival;
+    };
+
+    void initialize();
+    void dispatchLoop();
+    CorridorResult solveRequest(const CorridorRequest& request, MinCurvatureOptimizer& optimizer) const;
+
+    std::unique_ptr<BatchOptimizerParams> params_;
+    // One optimizer per worker thread, OSQP workspaces are not shared
+    std::vector<std::unique_ptr<MinCurvatureOptimizer>> optimizers_;
+    std::mutex solve_mutex_;
+
+    // Coalescing queue
+    std::deque<PendingRequest> queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::atomic<bool> running_{true};
+    std::thread dispatcher_;
+};
+} // namespace optimization
+} // namespace spline
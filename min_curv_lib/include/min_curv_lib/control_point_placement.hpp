@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/base_cubic_spline.hpp"
+
+namespace spline {
+
+struct ControlPointPlacement
+{
+    std::vector<Eigen::Vector2d> control_points;
+    std::vector<double> knots;  // Chord length parameterization, mean spacing of one
+};
+
+// Redistribute control points along a reference spline with a density of 1 + curvature_gain * |curvature|
+// per metre, so that corners get more points than straights. curvature_gain is in metres.
+const ControlPointPlacement placeControlPoints(const BaseCubicSpline& reference,
+                                               const std::size_t num_control_points,
+                                               const double curvature_gain,
+                                               const std::size_t num_samples = 200);
+} // namespace spline
@@ -13,6 +13,13 @@ public:
     ParametricCubicSpline();
     ~ParametricCubicSpline() = default;
     ParametricCubicSpline(const std::vector<Eigen::Vector2d>& control_points);
+    ParametricCubicSpline(const std::vector<Eigen::Vector2d>& control_points, const std::vector<double>& knots);
+    // Uniform knots, one unit of parameter per segment
+    void setControlPoints(const std::vector<Eigen::Vector2d>& control_points) override;
+    // Non-uniform knots, strictly increasing parameter value of each control point
+    void setControlPoints(const std::vector<Eigen::Vector2d>& control_points, const std::vector<double>& knots);
+    const Eigen::VectorXd getParameterSpacing() const override;
+    const std::vector<double>& getKnots() const;
     const Eigen::Vector2d evaluateSpline(const double u, const std::size_t derivative_order) const override;
     const double computeCurvature(const double u) const override;
     const std::pair<Eigen::MatrixXd, Eigen::MatrixXd> getCoefficients() const override;
@@ -23,6 +30,7 @@ private:
     // Helper function to find the correct interval and local u
     void getIntervalAndLocalT(const double u, std::size_t &i, double &local_u) const;
 
+    std::vector<double> knots_;                 // Parameter value of each control point
     std::vector<double> a_x_, b_x_, c_x_, d_x_; // Spline coefficients for x
     std::vector<double> a_y_, b_y_, c_y_, d_y_; // Spline coefficients for y
 };
@@ -3,15 +3,25 @@
 #include <OsqpEigen/OsqpEigen.h>
 #include <vector>
 #include <memory>
+#include <string>
 #include <Eigen/Dense>
 
 #include "min_curv_lib/nanoflann.hpp"
 #include "min_curv_lib/kd_tree_adapter.hpp"
 #include "min_curv_lib/base_cubic_spline.hpp"
+#include "min_curv_lib/solution_cache.hpp"
+#include "min_curv_lib/distance_field.hpp"
 
 namespace spline {
 namespace optimization {
 
+enum class QPFormulation
+{
+    DenseSpline,   // Lateral offsets only, dense Hessian through the inverse of the system matrix
+    SparseSpline,  // Offsets and spline coefficients, continuity as sparse equality constraints
+    DiscreteCurvature,  // Second differences of the shifted control points, pentadiagonal Hessian
+};
+
 struct MinCurvatureParams
 {
     bool verbose = false;
@@ -23,6 +33,26 @@ struct MinCurvatureParams
     std::size_t num_nearest = 3;
     std::size_t kdtree_leafs = 10;
     double shrink = 0.3;
+    // OSQP stopping tolerances, absolute and relative
+    double eps_abs = 1e-3;
+    double eps_rel = 1e-3;
+    QPFormulation formulation = QPFormulation::DenseSpline;
+    // Cache of solutions keyed on quantized inputs, useful when the same corridor repeats every lap
+    bool use_cache = false;
+    std::size_t cache_size = 64;
+    double cache_quantization = 0.01;
+    // Operator cache and last primal/dual solution, saved every checkpoint_interval solves and on
+    // destruction, and reloaded at construction so that the first frame after a restart is warm
+    std::string checkpoint_file = "";
+    std::size_t checkpoint_interval = 100;
+    // Warm start OSQP with the previous primal/dual solution, or the one of the checkpoint, while the
+    // problem size is unchanged. Measured with OSQP on sliding windows of the example track it saved
+    // iterations at 200 control points and cost some at 250 and 400, so it is opt-in
+    bool reuse_solution = false;
+    // Dense formulation: solve H x = -c first and only run OSQP when that solution violates a bound
+    bool unconstrained_fast_path = false;
+    // Distance field corridors: widths are searched along each normal up to this distance [m]
+    double max_corridor_width = 20.0;
 
     MinCurvatureParams() = default;
     MinCurvatureParams(bool verbose, 
@@ -40,24 +70,117 @@ struct MinCurvatureParams
           num_nearest(num_nearest), kdtree_leafs(kdtree_leafs), shrink(shrink) {}
 };
 
+// Outcome of the last solve
+enum class SolveStatus
+{
+    Solved,         // OSQP converged, or the cache or the unconstrained fast path answered
+    MaxIterations,  // OSQP stopped at max_num_iterations, the offsets are its last iterate
+    Failed,         // OSQP found the problem infeasible or failed otherwise, or the offsets are not finite
+};
+
+const std::string toString(const SolveStatus status);
+
+// QP as handed to OSQP: min 1/2 x'Px + q'x  s.t.  lower_bound <= Ax <= upper_bound
+struct QPProblem
+{
+    Eigen::SparseMatrix<double> P;
+    Eigen::VectorXd q;
+    Eigen::SparseMatrix<double> A;
+    Eigen::VectorXd lower_bound;
+    Eigen::VectorXd upper_bound;
+};
+
+struct FastPathStats
+{
+    std::size_t hits = 0;    // Solves answered by the unconstrained solution
+    std::size_t misses = 0;  // Attempts that hit a bound and fell back to OSQP
+    std::size_t factorization_reuses = 0;
+
+    const double hitRate() const;
+};
+
+// Reference-dependent part of the dense problem, shared by every corridor around the same reference
+struct ReferenceSetup
+{
+    std::shared_ptr<BaseCubicSpline> ref_spline;
+    Eigen::MatrixXd normal_vectors;
+    Eigen::MatrixXd H;
+    Eigen::VectorXd c;
+};
+
+// Bounds of one candidate corridor around a shared reference. Taken from the distance field if set,
+// else from the boundary splines if both are set, else from the widths along the normals (N x 2).
+struct CandidateCorridor
+{
+    std::shared_ptr<const DistanceField> distance_field;
+    std::shared_ptr<BaseCubicSpline> left_spline;
+    std::shared_ptr<BaseCubicSpline> right_spline;
+    Eigen::MatrixXd widths;
+};
+
 class MinCurvatureOptimizer {
 public:
     MinCurvatureOptimizer();
     MinCurvatureOptimizer(std::unique_ptr<MinCurvatureParams> params);
+    // Takes the inverse of the uniform system matrix instead of factorizing it, e.g. from a TrackMap
+    MinCurvatureOptimizer(std::unique_ptr<MinCurvatureParams> params, const Eigen::MatrixXd& system_inverse);
+    ~MinCurvatureOptimizer();
     void setSplines(const std::shared_ptr<BaseCubicSpline>& ref_spline,
                     const std::shared_ptr<BaseCubicSpline>& left_spline,
                     const std::shared_ptr<BaseCubicSpline>& right_spline);
+    // Map-based corridor: free width to the left and right of every control point, measured along the
+    // normal (N x 2). Replaces the boundary splines and skips the boundary distance search entirely.
+    void setCorridor(const std::shared_ptr<BaseCubicSpline>& ref_spline, const Eigen::MatrixXd& widths);
+    // Distance field corridor: widths are found by marching along the normals through the field, one
+    // grid lookup per step. The field is shared, not copied, and must not change while it is set.
+    void setDistanceField(const std::shared_ptr<BaseCubicSpline>& ref_spline, const std::shared_ptr<const DistanceField>& field);
+    // Pins the first displacements.rows() control points in the following setUps, e.g. to continue a
+    // trajectory that is already published. Rows are displacements from the reference points (offset times
+    // normal, before normal_weight), projected onto this problem's own normals and clamped to the corridor.
+    // The solution cache is bypassed while points are pinned, an empty matrix releases them.
+    void setFixedDisplacements(const Eigen::MatrixXd& displacements);
+    // Warm-up solves of synthetic corridors neither read nor fill the cache and write no checkpoint. Ending
+    // the warm-up restores the warm start state and the fast path statistics from before it.
+    void setWarmUp(const bool warm_up);
     void setUp(const double last_point_shrink = 0.5);
+    // Normals, H and c of the dense formulation for a reference, computed once for several corridors
+    const ReferenceSetup setUpReference(const std::shared_ptr<BaseCubicSpline>& ref_spline);
+    // Dense setUp of one corridor around a reference from setUpReference, only the bounds are computed
+    void setUp(const ReferenceSetup& reference, const CandidateCorridor& corridor, const double last_point_shrink = 0.5);
 
     void solve(std::shared_ptr<BaseCubicSpline>& opt_traj, const double normal_weight = 1.0);
 
+    const CacheStats getCacheStats() const;
+    const FastPathStats& getFastPathStats() const;
+    const Eigen::MatrixXd& getSystemMatrixInverse() const;
+    // Problem of the last setUp that missed the cache, and the lateral offsets of the last solve
+    const QPProblem getProblem() const;
+    const Eigen::VectorXd& getSolution() const;
+    // Unit normals (N x 2) of the last setUp, the offsets of getSolution are along them
+    const Eigen::MatrixXd& getNormalVectors() const;
+    // 1/2 x'Hx + c'x of the last solve of the dense formulation
+    const double getObjective() const;
+    // OSQP iterations of the last solve, 0 if it was answered by the cache or the fast path
+    const std::size_t getIterations() const;
+    const SolveStatus getStatus() const;
+
 private:
     void initSolver();
+    const bool lookUpCache(const double last_point_shrink);
     void setupQP(const double last_point_shrink);
+    void loadDenseProblem();
+    const bool solveUnconstrained();
+    void loadCheckpoint();
+    const bool saveCheckpoint() const;
+    void computeNormalVectors();
     void computeHessianAndLinear();
+    void computeSparseProblem();
+    void computeDiscreteProblem();
     void computeConstraints(const double last_point_shrink);
     const Eigen::MatrixXd getBoundaryDistance() const; 
     void setSystemMatrixInverse(const std::size_t size);
+    void setSystemMatrixInverse(const Eigen::VectorXd& spacing);
+    const Eigen::SparseMatrix<double> getSystemMatrix(const Eigen::VectorXd& spacing) const;
     const Eigen::SparseMatrix<double> toSparseMatrix(const Eigen::MatrixXd& matrix) const;
     const Eigen::MatrixXd fromSparseMatrix(const Eigen::SparseMatrix<double>& sparse_matrix) const;
     
@@ -65,6 +188,9 @@ private:
     std::shared_ptr<BaseCubicSpline> ref_spline_ = nullptr;
     std::shared_ptr<BaseCubicSpline> left_spline_ = nullptr;
     std::shared_ptr<BaseCubicSpline> right_spline_ = nullptr;
+    Eigen::MatrixXd corridor_widths_;  // Used instead of the boundary splines when not empty
+    std::shared_ptr<const DistanceField> distance_field_;  // Used instead of both when set
+    Eigen::MatrixXd fixed_displacements_;                   // Leading points pinned by setFixedDisplacements
     Eigen::MatrixXd normal_vectors_;
 
     // Parameters
@@ -78,6 +204,44 @@ private:
     Eigen::MatrixXd system_inverse_;  // Inverse of the system matrix
     Eigen::VectorXd lower_bound_;     // Lower bound for constraints
     Eigen::VectorXd upper_bound_;     // Upper bound for constraints
+
+    // Sparse formulations
+    Eigen::SparseMatrix<double> P_sparse_;   // Quadratic hessian matrix
+    Eigen::VectorXd q_sparse_;               // Linear cost vector
+    Eigen::SparseMatrix<double> A_sparse_;   // Constraint matrix
+    Eigen::VectorXd sparse_lower_bound_;
+    Eigen::VectorXd sparse_upper_bound_;
+
+    // Solution cache
+    std::unique_ptr<SolutionCache> cache_;
+    SolutionCache::Key cache_key_;
+    CachedSolution cached_solution_;
+    bool cache_hit_ = false;
+    double setup_time_ = 0.0;  // Duration of the last setUp [ms]
+
+    double last_point_shrink_ = 0.5;
+    Eigen::VectorXd solution_;  // Lateral offsets of the last solve, before weighting
+
+    // Warm start from the previous solve, possibly restored from a checkpoint
+    Eigen::VectorXd last_primal_;
+    Eigen::VectorXd last_dual_;
+    std::size_t num_variables_ = 0;
+    std::size_t num_constraints_ = 0;
+    std::size_t solves_since_checkpoint_ = 0;
+
+    // State set aside while warming up
+    bool warm_up_ = false;
+    Eigen::VectorXd warm_up_primal_;
+    Eigen::VectorXd warm_up_dual_;
+    FastPathStats warm_up_fast_path_stats_;
+
+    std::size_t last_iterations_ = 0;
+    SolveStatus status_ = SolveStatus::Failed;
+
+    // Unconstrained fast path, the factorization is kept while the free block of H_ is unchanged
+    Eigen::MatrixXd fast_path_hessian_;
+    Eigen::LDLT<Eigen::MatrixXd> fast_path_factorization_;
+    FastPathStats fast_path_stats_;
 };
 } // namespace optimization
 } // namespace spline
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+
+namespace spline {
+namespace optimization {
+
+// Signed distance field on a regular grid, positive in free space and negative inside obstacles [m].
+// Built with the exact linear-time Euclidean distance transform of Felzenszwalb and Huttenlocher,
+// one pass over the columns and one over the rows. Cell (x, y) is stored at y * width + x and its
+// center lies at origin + (x + 0.5, y + 0.5) * resolution, like a nav_msgs/OccupancyGrid.
+class DistanceField {
+public:
+    DistanceField() = default;
+    // Cells at or above occupied_threshold are obstacles, unknown cells (< 0) too if unknown_is_occupied
+    DistanceField(const std::vector<std::int8_t>& occupancy,
+                  const std::size_t width,
+                  const std::size_t height,
+                  const double resolution,
+                  const Eigen::Vector2d& origin,
+                  const int occupied_threshold = 50,
+                  const bool unknown_is_occupied = true);
+
+    // Rasterizes the corridor between two boundary polylines, everything outside of it is an obstacle.
+    // Both boundaries are extended by margin beyond their ends, so the ends of the corridor stay open
+    // for the first and last control point, and the grid is padded by margin on every side.
+    static const DistanceField fromBoundaries(const std::vector<Eigen::Vector2d>& left_boundary,
+                                              const std::vector<Eigen::Vector2d>& right_boundary,
+                                              const double resolution,
+                                              const double margin = 5.0);
+
+    // Bilinear interpolation of the cell centers, outside the grid is an obstacle
+    const double distance(const Eigen::Vector2d& point) const;
+    // Free distance from point along the unit direction, at most max_distance. Sphere tracing: the field
+    // is the largest step that cannot cross an obstacle, so wide corridors take few lookups.
+    const double freeDistance(const Eigen::Vector2d& point, const Eigen::Vector2d& direction, const double max_distance) const;
+
+    const bool empty() const;
+    const std::size_t width() const;
+    const std::size_t height() const;
+    const double resolution() const;
+    const Eigen::Vector2d& origin() const;
+
+private:
+    void transform(const std::vector<std::uint8_t>& occupied);
+    const double cell(const std::ptrdiff_t x, const std::ptrdiff_t y) const;
+
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    double resolution_ = 0.0;
+    Eigen::Vector2d origin_ = Eigen::Vector2d::Zero();
+    std::vector<float> field_;
+};
+} // namespace optimization
+} // namespace spline
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <sys/types.h>
+
+#include "min_curv_lib/batch_optimizer.hpp"
+
+namespace spline {
+namespace optimization {
+
+struct ProcessDispatcherParams
+{
+    std::size_t num_workers = 4;
+    std::size_t max_retries = 2;  // Resubmissions of a request whose worker crashed or timed out
+    double timeout = 0.0;         // Per attempt, 0 waits forever [ms]
+    MinCurvatureParams optimizer;
+
+    ProcessDispatcherParams() = default;
+    ProcessDispatcherParams(std::size_t num_workers,
+                            std::size_t max_retries,
+                            double timeout,
+                            const MinCurvatureParams& optimizer)
+        : num_workers(num_workers), max_retries(max_retries),
+          timeout(timeout), optimizer(optimizer) {}
+};
+
+// Solves corridor windows or full tracks in forked worker processes on the local host, for offline
+// work that outgrows the threads of one process. Each worker owns an optimizer and talks to the
+// dispatcher over a Unix socket pair, one length-prefixed request or result at a time. A worker that
+// exits, crashes or exceeds the timeout is replaced and its request goes to the next idle worker.
+// The workers are forked in the constructor and after a crash, so create the dispatcher before the
+// process starts other threads.
+class ProcessDispatcher {
+public:
+    ProcessDispatcher();
+    ProcessDispatcher(std::unique_ptr<ProcessDispatcherParams> params);
+    ~ProcessDispatcher();
+    ProcessDispatcher(const ProcessDispatcher&) = delete;
+    ProcessDispatcher& operator=(const ProcessDispatcher&) = delete;
+
+    // Blocks until every request is solved or has failed max_retries + 1 times, results in request order.
+    // queue_time is the time until the request was handed to the worker that solved it.
+    std::vector<CorridorResult> solve(const std::vector<CorridorRequest>& requests);
+    // Workers replaced after a crash or timeout since construction
+    const std::size_t getRestarts() const;
+
+private:
+    static constexpr std::size_t kIdle = std::numeric_limits<std::size_t>::max();
+
+    struct Worker {
+        pid_t pid = -1;
+        int socket = -1;
+        std::size_t job = kIdle;  // Index of the request being solved
+        std::chrono::steady_clock::time_point started;
+    };
+
+    void startWorker(Worker& worker);
+    void stopWorker(Worker& worker);
+    static void workerLoop(const int socket, const MinCurvatureParams& optimizer_params);
+
+    std::unique_ptr<ProcessDispatcherParams> params_;
+    std::vector<Worker> workers_;
+    std::size_t restarts_ = 0;
+};
+} // namespace optimization
+} // namespace spline
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/nanoflann.hpp"
+#include "min_curv_lib/kd_tree_adapter.hpp"
+
+namespace spline {
+namespace optimization {
+
+struct RacelineParams
+{
+    bool closed = true;           // The track is a closed circuit, windows may wrap around
+    double max_deviation = 0.5;   // Maximum distance between perceived and map centerline [m]
+    std::size_t min_window_size = 4;
+    std::size_t kdtree_leafs = 10;
+
+    RacelineParams() = default;
+    RacelineParams(bool closed, double max_deviation, std::size_t min_window_size, std::size_t kdtree_leafs)
+        : closed(closed), max_deviation(max_deviation),
+          min_window_size(min_window_size), kdtree_leafs(kdtree_leafs) {}
+};
+
+class TrackMap;
+
+struct RacelineWindow
+{
+    std::vector<Eigen::Vector2d> points;
+    std::vector<double> curvature;
+    std::size_t start_index = 0;
+    double deviation = 0.0;  // Maximum distance of the perceived centerline to the map centerline [m]
+    std::string rejection;   // Why getWindow returned false, empty otherwise
+};
+
+// Precomputed full-track optimized raceline, sliced online around the vehicle
+class Raceline {
+public:
+    Raceline();
+    Raceline(std::unique_ptr<RacelineParams> params);
+
+    // Text file with one "x y curvature center_x center_y" row per raceline sample
+    void load(const std::string& file_name);
+    static void save(const std::string& file_name,
+                     const std::vector<Eigen::Vector2d>& points,
+                     const std::vector<double>& curvature,
+                     const std::vector<Eigen::Vector2d>& centerline);
+    void setRaceline(const std::vector<Eigen::Vector2d>& points,
+                     const std::vector<double>& curvature,
+                     const std::vector<Eigen::Vector2d>& centerline);
+    // Samples and k-d tree of a memory-mapped track map, the index is deserialized instead of rebuilt
+    void setRaceline(const TrackMap& track_map);
+    void saveIndex(std::ostream& stream) const;
+
+    // Slice matching the perceived centerline, false if the corridor deviates from the map
+    const bool getWindow(const std::vector<Eigen::Vector2d>& perceived_centerline, RacelineWindow& window) const;
+    // Index of the map centerline sample closest to a point, O(log N)
+    const std::size_t findNearestIndex(const Eigen::Vector2d& point, double& distance) const;
+
+    const std::size_t size() const;
+    const std::vector<Eigen::Vector2d>& getPoints() const;
+    const std::vector<double>& getCurvature() const;
+    const std::vector<Eigen::Vector2d>& getCenterline() const;
+    const RacelineParams& getParams() const;
+
+private:
+    using KDTree = nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<double, KDTreeAdapter>, KDTreeAdapter, 2>;
+
+    void buildIndex();
+
+    std::unique_ptr<RacelineParams> params_;
+    std::vector<Eigen::Vector2d> points_;
+    std::vector<double> curvature_;
+    std::vector<Eigen::Vector2d> centerline_;
+
+    // Spatial index over the map centerline
+    std::unique_ptr<KDTreeAdapter> centerline_cloud_;
+    std::unique_ptr<KDTree> centerline_tree_;
+};
+} // namespace optimization
+} // namespace spline
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <Eigen/Dense>
+
+namespace spline {
+namespace optimization {
+
+struct CacheStats
+{
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    double saved_time = 0.0;  // Accumulated setup and solve time avoided by hits [ms]
+
+    const double hitRate() const;
+};
+
+struct CachedSolution
+{
+    Eigen::VectorXd solution;        // Lateral offsets returned by the solver
+    Eigen::MatrixXd normal_vectors;  // Normal vectors the offsets are applied along
+    double compute_time = 0.0;       // Setup and solve time of the original computation [ms]
+};
+
+// LRU cache of optimizer solutions keyed on quantized corridor inputs
+class SolutionCache {
+public:
+    // Quantized inputs, compared in full on lookup so that hash collisions never return a wrong solution
+    using Key = std::vector<std::int64_t>;
+
+    SolutionCache(const std::size_t capacity, const double quantization);
+
+    const Key makeKey(const std::vector<Eigen::Vector2d>& ref_points,
+                      const std::vector<Eigen::Vector2d>& left_points,
+                      const std::vector<Eigen::Vector2d>& right_points,
+                      const std::vector<double>& params) const;
+    const CachedSolution* find(const Key& key);
+    void insert(const Key& key, const CachedSolution& solution);
+    void addSavedTime(const double saved_time);
+    void clear();
+
+    const CacheStats& getStats() const;
+    const std::size_t size() const;
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+    using Entry = std::pair<Key, CachedSolution>;
+
+    const std::int64_t quantize(const double value) const;
+
+    std::size_t capacity_;
+    double quantization_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    CacheStats stats_;
+};
+} // namespace optimization
+} // namespace spline
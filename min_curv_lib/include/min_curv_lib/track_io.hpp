@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <Eigen/Dense>
+
+namespace spline {
+
+// Load "x y" rows, as in boundary_publisher_example/data
+const std::vector<Eigen::Vector2d> loadPoints(const std::string& file_name);
+// Resample a polyline to equally spaced points along its arc length
+const std::vector<Eigen::Vector2d> resamplePolyline(const std::vector<Eigen::Vector2d>& points, const std::size_t num_points);
+} // namespace spline
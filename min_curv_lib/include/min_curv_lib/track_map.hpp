@@ -0,0 +1,72 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/raceline.hpp"
+
+namespace spline {
+namespace optimization {
+
+// Precomputed track in a versioned binary file, memory-mapped so that the k-d tree and the system
+// matrix inverses are read instead of rebuilt at startup. The samples are copied out by the
+// raceline, so the map can be closed once it is loaded.
+// Layout: header, raceline samples (x, y, curvature, center_x, center_y as separate arrays),
+// serialized centerline k-d tree and optional uniform system matrix inverses. Every section
+// starts on an 8-byte boundary.
+class TrackMap {
+public:
+    static constexpr std::uint32_t kVersion = 2;
+
+    TrackMap() = default;
+    TrackMap(const std::string& file_name);
+    ~TrackMap();
+    TrackMap(const TrackMap&) = delete;
+    TrackMap& operator=(const TrackMap&) = delete;
+
+    // Operators are keyed on the number of control points
+    static void save(const std::string& file_name,
+                     const Raceline& raceline,
+                     const std::map<std::size_t, Eigen::MatrixXd>& system_inverses = {});
+
+    void open(const std::string& file_name);
+    void close();
+    const bool isOpen() const;
+
+    const bool closed() const;
+    const std::size_t numSamples() const;
+    const std::size_t kdtreeLeafs() const;
+    const std::vector<Eigen::Vector2d> getPoints() const;
+    const std::vector<double> getCurvature() const;
+    const std::vector<Eigen::Vector2d> getCenterline() const;
+    // Pointers into the mapped file, valid while the map is open
+    const char* getIndex(std::size_t& size) const;
+    // Column-major 4N x 4N matrix, null if the file holds no inverse for this number of control points
+    const double* getSystemInverse(const std::size_t num_control_points) const;
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t num_samples;
+        std::uint64_t kdtree_leafs;
+        std::uint64_t index_size;
+        std::uint64_t num_operators;
+        std::uint8_t closed;
+        std::uint8_t padding[7];
+    };
+
+    int file_descriptor_ = -1;
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    const Header* header_ = nullptr;
+    const double* samples_ = nullptr;     // 5 x num_samples
+    const char* index_ = nullptr;
+    std::map<std::size_t, const double*> system_inverses_;
+};
+} // namespace optimization
+} // namespace spline
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/base_cubic_spline.hpp"
+
+namespace spline {
+
+struct TrajectorySample
+{
+    double s = 0.0;          // Arc length from the start of the trajectory [m]
+    Eigen::Vector2d position = Eigen::Vector2d::Zero();
+    double heading = 0.0;    // [rad]
+    double curvature = 0.0;  // Signed, positive to the left [1/m]
+};
+
+// Arc length parametrized table of one trajectory. The number of samples is fixed at construction so
+// that neither publishing nor querying allocates.
+class TrajectorySnapshot {
+public:
+    TrajectorySnapshot(const std::size_t num_samples);
+
+    void assign(const BaseCubicSpline& trajectory, const std::uint64_t sequence, const double stamp);
+
+    // Interpolated sample at arc length s, clamped to the trajectory
+    const TrajectorySample sample(const double s) const;
+    // Closest point on the sampled polyline, O(N)
+    const TrajectorySample closestPoint(const Eigen::Vector2d& point, double& distance) const;
+
+    const double length() const;
+    const std::uint64_t sequence() const;
+    const double stamp() const;
+
+private:
+    std::vector<TrajectorySample> samples_;
+    std::uint64_t sequence_ = 0;
+    double stamp_ = 0.0;
+};
+
+// Triple-buffered snapshot of the latest trajectory. One writer publishes while any number of readers
+// query without locks, allocation or waiting: a reader pins the current slot with a counter and the
+// writer only fills slots that are neither current nor pinned.
+class TrajectoryBuffer {
+public:
+    class ReadGuard {
+    public:
+        ReadGuard(const TrajectoryBuffer& buffer);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const TrajectorySnapshot& operator*() const { return *snapshot_; }
+        const TrajectorySnapshot* operator->() const { return snapshot_; }
+
+    private:
+        const TrajectoryBuffer& buffer_;
+        std::size_t slot_;
+        const TrajectorySnapshot* snapshot_;
+    };
+
+    TrajectoryBuffer(const std::size_t num_samples = 200);
+
+    // Single writer. If slow readers pin both spare slots for a few retries the trajectory is dropped
+    // and false returned, readers keep the previous snapshot. The writer never waits on readers,
+    // which could be starved by a real-time writer thread.
+    const bool publish(const BaseCubicSpline& trajectory, const double stamp);
+
+    // Pins the latest snapshot for the lifetime of the guard, keep it short
+    ReadGuard read() const;
+    // False until the first trajectory has been published
+    const bool sample(const double s, TrajectorySample& sample) const;
+    const bool closestPoint(const Eigen::Vector2d& point, TrajectorySample& sample, double& distance) const;
+    const std::uint64_t sequence() const;
+    // Trajectories publish() dropped because no slot was free
+    const std::uint64_t dropped() const;
+
+private:
+    static constexpr std::size_t kNumSlots = 3;
+    static constexpr std::size_t kPublishAttempts = 16;
+
+    std::array<TrajectorySnapshot, kNumSlots> slots_;
+    mutable std::array<std::atomic<std::uint32_t>, kNumSlots> readers_;
+    std::atomic<std::size_t> current_{0};
+    std::atomic<std::uint64_t> sequence_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+};
+} // namespace spline
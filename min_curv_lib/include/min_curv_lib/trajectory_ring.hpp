@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+
+namespace spline {
+
+// Ring of the latest optimized trajectories in POSIX shared memory (/dev/shm/<name>) for local
+// processes that are not ROS nodes. Native byte order, every offset is a multiple of 64 bytes:
+//
+//   offset 0                   TrajectoryRingHeader
+//   (slot_size = 64 + 24 * max_points rounded up to a multiple of 64)
+//   64 + k * slot_size         slot k = 0 .. num_slots - 1
+//     + 0                      TrajectoryRingSlot
+//     + 64                     double x[max_points]
+//     + 64 + 8 * max_points    double y[max_points]
+//     + 64 + 16 * max_points   double curvature[max_points]   (signed, positive to the left [1/m])
+//
+// Trajectory n (counting from 0) goes into slot n % num_slots, write_count is n + 1 once it is
+// complete. Each slot is guarded by a seqlock: the writer makes sequence odd, writes the slot and
+// makes it even again. A reader loads sequence (acquire), skips the slot if it is odd, reads the
+// data in place, issues an acquire fence and accepts the data only if sequence is unchanged and
+// index is the trajectory it wanted. Readers never block the writer, a reader that is too slow
+// sees its trajectory overwritten and moves on. A writer taking over a segment closes the slots a
+// crashed writer left odd, and readers give up after a bounded number of retries.
+constexpr char kTrajectoryRingMagic[8] = {'M', 'C', 'R', 'I', 'N', 'G', '\0', '\0'};
+constexpr std::uint32_t kTrajectoryRingVersion = 1;
+
+struct alignas(64) TrajectoryRingHeader
+{
+    char magic[8];                          // Written last by the writer, readers reject the segment until then
+    std::uint32_t version;
+    std::uint32_t num_slots;
+    std::uint32_t max_points;
+    std::uint32_t slot_size;                // [bytes]
+    std::atomic<std::uint64_t> write_count; // Trajectories completely written so far
+};
+
+struct alignas(64) TrajectoryRingSlot
+{
+    std::atomic<std::uint64_t> sequence;  // Odd while the writer is in the slot
+    std::uint64_t index;                  // Trajectory number held by the slot
+    double stamp;                         // Stamp of the input the trajectory was computed from [s]
+    std::uint32_t num_points;
+    std::uint32_t reserved;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared memory needs address-free atomics.");
+static_assert(sizeof(TrajectoryRingHeader) == 64 && sizeof(TrajectoryRingSlot) == 64, "Layout is fixed.");
+
+struct RingTrajectory
+{
+    std::uint64_t index = 0;
+    double stamp = 0.0;
+    std::vector<Eigen::Vector2d> points;
+    std::vector<double> curvature;
+};
+
+class TrajectoryRingWriter {
+public:
+    // Creates or takes over the segment, one writer per name
+    TrajectoryRingWriter(const std::string& name, const std::size_t num_slots = 8, const std::size_t max_points = 512);
+    ~TrajectoryRingWriter();
+    TrajectoryRingWriter(const TrajectoryRingWriter&) = delete;
+    TrajectoryRingWriter& operator=(const TrajectoryRingWriter&) = delete;
+
+    // Trajectories longer than max_points are truncated
+    void write(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature, const double stamp);
+    const std::uint64_t writeCount() const;
+    // Removes the name, mapped readers keep their view
+    static void unlink(const std::string& name);
+
+private:
+    std::string name_;
+    char* data_ = nullptr;
+    std::size_t size_ = 0;
+    TrajectoryRingHeader* header_ = nullptr;
+};
+
+class TrajectoryRingReader {
+public:
+    // Throws if the segment does not exist or is not a trajectory ring of this version
+    TrajectoryRingReader(const std::string& name);
+    ~TrajectoryRingReader();
+    TrajectoryRingReader(const TrajectoryRingReader&) = delete;
+    TrajectoryRingReader& operator=(const TrajectoryRingReader&) = delete;
+
+    const std::uint64_t writeCount() const;
+    // Copy of trajectory index, false if it is not written yet, already overwritten or the slot
+    // stayed busy for kMaxAttempts tries
+    const bool read(const std::uint64_t index, RingTrajectory& trajectory) const;
+    // Latest complete trajectory, false before the first one or after kMaxAttempts tries
+    const bool readLatest(RingTrajectory& trajectory) const;
+
+private:
+    static constexpr std::size_t kMaxAttempts = 100;
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    const TrajectoryRingHeader* header_ = nullptr;
+};
+} // namespace spline
@@ -0,0 +1,285 @@
+// Python bindings of the splines and optimizers for offline analysis
+#include <pybind11/pybind11.h>
+#include <pybind11/eigen.h>
+#include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/base_cubic_spline.hpp"
+#include "min_curv_lib/cubic_spline.hpp"
+#include "min_curv_lib/cubic_b_spline.hpp"
+#include "min_curv_lib/curv_min.hpp"
+#include "min_curv_lib/distance_field.hpp"
+#include "min_curv_lib/batch_optimizer.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 2, Eigen::RowMajor>;
+// C-contiguous float64 arrays of shape (N, 2) bind to these without a copy
+using PointsRef = Eigen::Ref<const Points>;
+using PointsOut = Eigen::Ref<Points>;
+
+// std::vector<Eigen::Vector2d> has the layout of a row-major N x 2 array, so this is a single memcpy
+const std::vector<Eigen::Vector2d> toVector(const PointsRef& points) {
+    const auto* begin = reinterpret_cast<const Eigen::Vector2d*>(points.data());
+    return std::vector<Eigen::Vector2d>(begin, begin + points.rows());
+}
+
+// Arrays inside Python containers, the converted array (if any) stays alive while the points are copied
+const std::vector<Eigen::Vector2d> toVector(const py::handle& handle) {
+    const auto array = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure(handle);
+    if (!array || array.ndim() != 2 || array.shape(1) != 2) {
+        throw py::type_error("Expected an array of shape (N, 2).");
+    }
+    const auto* begin = reinterpret_cast<const Eigen::Vector2d*>(array.data());
+    return std::vector<Eigen::Vector2d>(begin, begin + array.shape(0));
+}
+
+// Returned by value, pybind11 moves the matrix into the array it hands to Python
+Points toArray(const std::vector<Eigen::Vector2d>& points) {
+    return Eigen::Map<const Points>(points.empty() ? nullptr : points.front().data(), points.size(), 2);
+}
+
+void evaluateInto(const spline::BaseCubicSpline& spline, const Eigen::Ref<const Eigen::VectorXd>& u,
+                  const std::size_t derivative_order, PointsOut out) {
+    if (out.rows() != u.size()) {
+        throw std::invalid_argument("Output must have one row per parameter value.");
+    }
+    for (Eigen::Index i = 0; i < u.size(); ++i) {
+        out.row(i) = spline.evaluateSpline(u(i), derivative_order).transpose();
+    }
+}
+
+void curvatureInto(const spline::BaseCubicSpline& spline, const Eigen::Ref<const Eigen::VectorXd>& u,
+                   Eigen::Ref<Eigen::VectorXd> out) {
+    if (out.size() != u.size()) {
+        throw std::invalid_argument("Output must have one entry per parameter value.");
+    }
+    for (Eigen::Index i = 0; i < u.size(); ++i) {
+        out(i) = spline.computeCurvature(u(i));
+    }
+}
+
+} // namespace
+
+PYBIND11_MODULE(min_curv_py, m) {
+    using namespace spline;
+    using namespace spline::optimization;
+    m.doc() = "Minimum curvature optimization with cubic splines";
+
+    py::class_<BaseCubicSpline, std::shared_ptr<BaseCubicSpline>>(m, "BaseCubicSpline")
+        .def("__len__", &BaseCubicSpline::size)
+        .def_property_readonly("control_points", [](const BaseCubicSpline& self) {
+            return toArray(self.getControlPoints());
+        })
+        .def("set_control_points", [](BaseCubicSpline& self, const PointsRef& points) {
+            self.setControlPoints(toVector(points));
+        }, py::arg("points"))
+        .def("coefficients", &BaseCubicSpline::getCoefficients)
+        .def("evaluate", [](const BaseCubicSpline& self, const double u, const std::size_t derivative_order) {
+            return self.evaluateSpline(u, derivative_order);
+        }, py::arg("u"), py::arg("derivative_order") = 0)
+        .def("curvature", [](const BaseCubicSpline& self, const double u) {
+            return self.computeCurvature(u);
+        }, py::arg("u"))
+        // Batch evaluation, the loop runs without the GIL
+        .def("evaluate_batch", [](const BaseCubicSpline& self, const Eigen::Ref<const Eigen::VectorXd>& u,
+                                  const std::size_t derivative_order) {
+            Points out(u.size(), 2);
+            {
+                py::gil_scoped_release release;
+                evaluateInto(self, u, derivative_order, out);
+            }
+            return out;
+        }, py::arg("u"), py::arg("derivative_order") = 0)
+        .def("evaluate_into", &evaluateInto, py::arg("u"), py::arg("derivative_order"), py::arg("out").noconvert(),
+             py::call_guard<py::gil_scoped_release>(),
+             "Write into a preallocated C-contiguous float64 (N, 2) array")
+        .def("curvature_batch", [](const BaseCubicSpline& self, const Eigen::Ref<const Eigen::VectorXd>& u) {
+            Eigen::VectorXd out(u.size());
+            {
+                py::gil_scoped_release release;
+                curvatureInto(self, u, out);
+            }
+            return out;
+        }, py::arg("u"))
+        .def("curvature_into", &curvatureInto, py::arg("u"), py::arg("out").noconvert(),
+             py::call_guard<py::gil_scoped_release>(),
+             "Write into a preallocated float64 (N,) array");
+
+    py::class_<ParametricCubicSpline, BaseCubicSpline, std::shared_ptr<ParametricCubicSpline>>(m, "ParametricCubicSpline")
+        .def(py::init<>())
+        .def(py::init([](const PointsRef& points) {
+            return std::make_shared<ParametricCubicSpline>(toVector(points));
+        }), py::arg("points"))
+        .def(py::init([](const PointsRef& points, const std::vector<double>& knots) {
+            return std::make_shared<ParametricCubicSpline>(toVector(points), knots);
+        }), py::arg("points"), py::arg("knots"))
+        .def("set_control_points", [](ParametricCubicSpline& self, const PointsRef& points, const std::vector<double>& knots) {
+            self.setControlPoints(toVector(points), knots);
+        }, py::arg("points"), py::arg("knots"))
+        .def_property_readonly("knots", &ParametricCubicSpline::getKnots);
+
+    py::class_<CubicBSpline, BaseCubicSpline, std::shared_ptr<CubicBSpline>>(m, "CubicBSpline")
+        .def(py::init<>())
+        .def(py::init([](const PointsRef& points) {
+            return std::make_shared<CubicBSpline>(toVector(points));
+        }), py::arg("points"));
+
+    py::enum_<QPFormulation>(m, "QPFormulation")
+        .value("DenseSpline", QPFormulation::DenseSpline)
+        .value("SparseSpline", QPFormulation::SparseSpline)
+        .value("DiscreteCurvature", QPFormulation::DiscreteCurvature);
+
+    py::enum_<SolveStatus>(m, "SolveStatus")
+        .value("Solved", SolveStatus::Solved)
+        .value("MaxIterations", SolveStatus::MaxIterations)
+        .value("Failed", SolveStatus::Failed);
+
+    py::class_<MinCurvatureParams>(m, "MinCurvatureParams")
+        .def(py::init<>())
+        .def_readwrite("verbose", &MinCurvatureParams::verbose)
+        .def_readwrite("constant_system_matrix", &MinCurvatureParams::constant_system_matrix)
+        .def_readwrite("warm_start", &MinCurvatureParams::warm_start)
+        .def_readwrite("reuse_solution", &MinCurvatureParams::reuse_solution)
+        .def_readwrite("num_control_points", &MinCurvatureParams::num_control_points)
+        .def_readwrite("max_num_iterations", &MinCurvatureParams::max_num_iterations)
+        .def_readwrite("num_points_evaluate", &MinCurvatureParams::num_points_evaluate)
+        .def_readwrite("num_nearest", &MinCurvatureParams::num_nearest)
+        .def_readwrite("kdtree_leafs", &MinCurvatureParams::kdtree_leafs)
+        .def_readwrite("shrink", &MinCurvatureParams::shrink)
+        .def_readwrite("eps_abs", &MinCurvatureParams::eps_abs)
+        .def_readwrite("eps_rel", &MinCurvatureParams::eps_rel)
+        .def_readwrite("formulation", &MinCurvatureParams::formulation)
+        .def_readwrite("use_cache", &MinCurvatureParams::use_cache)
+        .def_readwrite("cache_size", &MinCurvatureParams::cache_size)
+        .def_readwrite("cache_quantization", &MinCurvatureParams::cache_quantization)
+        .def_readwrite("unconstrained_fast_path", &MinCurvatureParams::unconstrained_fast_path)
+        .def_readwrite("max_corridor_width", &MinCurvatureParams::max_corridor_width);
+
+    py::class_<CacheStats>(m, "CacheStats")
+        .def_readonly("hits", &CacheStats::hits)
+        .def_readonly("misses", &CacheStats::misses)
+        .def_readonly("saved_time", &CacheStats::saved_time)
+        .def_property_readonly("hit_rate", &CacheStats::hitRate);
+
+    py::class_<FastPathStats>(m, "FastPathStats")
+        .def_readonly("hits", &FastPathStats::hits)
+        .def_readonly("misses", &FastPathStats::misses)
+        .def_readonly("factorization_reuses", &FastPathStats::factorization_reuses)
+        .def_property_readonly("hit_rate", &FastPathStats::hitRate);
+
+    py::class_<DistanceField, std::shared_ptr<DistanceField>>(m, "DistanceField")
+        .def(py::init([](const py::array_t<std::int8_t, py::array::c_style | py::array::forcecast>& occupancy,
+                         const double resolution, const Eigen::Vector2d& origin, const int occupied_threshold,
+                         const bool unknown_is_occupied) {
+            if (occupancy.ndim() != 2) {
+                throw py::type_error("Expected an occupancy array of shape (height, width).");
+            }
+            const std::vector<std::int8_t> cells(occupancy.data(), occupancy.data() + occupancy.size());
+            return std::make_shared<DistanceField>(cells, occupancy.shape(1), occupancy.shape(0), resolution, origin,
+                                                   occupied_threshold, unknown_is_occupied);
+        }), py::arg("occupancy"), py::arg("resolution"), py::arg("origin"), py::arg("occupied_threshold") = 50,
+            py::arg("unknown_is_occupied") = true)
+        .def_static("from_boundaries", [](const py::handle& left, const py::handle& right, const double resolution,
+                                          const double margin) {
+            return std::make_shared<DistanceField>(DistanceField::fromBoundaries(toVector(left), toVector(right),
+                                                                                 resolution, margin));
+        }, py::arg("left_boundary"), py::arg("right_boundary"), py::arg("resolution"), py::arg("margin") = 5.0)
+        .def("distance", &DistanceField::distance, py::arg("point"))
+        .def_property_readonly("shape", [](const DistanceField& self) {
+            return py::make_tuple(self.height(), self.width());
+        })
+        .def_property_readonly("resolution", &DistanceField::resolution)
+        .def_property_readonly("origin", &DistanceField::origin);
+
+    // One optimizer must not be used from several Python threads at once, create one per thread
+    py::class_<MinCurvatureOptimizer>(m, "MinCurvatureOptimizer")
+        .def(py::init([](const MinCurvatureParams& params) {
+            return std::make_unique<MinCurvatureOptimizer>(std::make_unique<MinCurvatureParams>(params));
+        }), py::arg("params") = MinCurvatureParams())
+        .def("set_splines", &MinCurvatureOptimizer::setSplines,
+             py::arg("reference"), py::arg("left_boundary"), py::arg("right_boundary"))
+        .def("set_corridor", &MinCurvatureOptimizer::setCorridor, py::arg("reference"), py::arg("widths"))
+        .def("set_fixed_displacements", &MinCurvatureOptimizer::setFixedDisplacements, py::arg("displacements"))
+        .def("set_distance_field", [](MinCurvatureOptimizer& self, const std::shared_ptr<BaseCubicSpline>& reference,
+                                      const std::shared_ptr<DistanceField>& field) {
+            self.setDistanceField(reference, field);
+        }, py::arg("reference"), py::arg("field"))
+        .def("set_up", py::overload_cast<const double>(&MinCurvatureOptimizer::setUp), py::arg("last_point_shrink") = 0.5,
+             py::call_guard<py::gil_scoped_release>())
+        .def("solve", [](MinCurvatureOptimizer& self, const double normal_weight) {
+            std::shared_ptr<BaseCubicSpline> optimized = std::make_shared<ParametricCubicSpline>();
+            self.solve(optimized, normal_weight);
+            return optimized;
+        }, py::arg("normal_weight") = 1.0, py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("cache_stats", &MinCurvatureOptimizer::getCacheStats)
+        .def_property_readonly("fast_path_stats", &MinCurvatureOptimizer::getFastPathStats)
+        .def_property_readonly("iterations", &MinCurvatureOptimizer::getIterations)
+        .def_property_readonly("status", &MinCurvatureOptimizer::getStatus)
+        .def_property_readonly("solution", &MinCurvatureOptimizer::getSolution)
+        .def_property_readonly("normal_vectors", &MinCurvatureOptimizer::getNormalVectors);
+
+    py::class_<CorridorResult>(m, "CorridorResult")
+        .def_readonly("success", &CorridorResult::success)
+        .def_readonly("message", &CorridorResult::message)
+        .def_property_readonly("control_points", [](const CorridorResult& self) {
+            return toArray(self.control_points);
+        })
+        .def_readonly("batch_size", &CorridorResult::batch_size)
+        .def_readonly("queue_time", &CorridorResult::queue_time)
+        .def_readonly("setup_time", &CorridorResult::setup_time)
+        .def_readonly("solve_time", &CorridorResult::solve_time);
+
+    py::class_<CandidateResult>(m, "CandidateResult")
+        .def_readonly("success", &CandidateResult::success)
+        .def_readonly("status", &CandidateResult::status)
+        .def_readonly("message", &CandidateResult::message)
+        .def_property_readonly("control_points", [](const CandidateResult& self) {
+            return toArray(self.control_points);
+        })
+        .def_readonly("objective", &CandidateResult::objective)
+        .def_readonly("reference_time", &CandidateResult::reference_time)
+        .def_readonly("setup_time", &CandidateResult::setup_time)
+        .def_readonly("solve_time", &CandidateResult::solve_time);
+
+    py::class_<BatchOptimizer>(m, "BatchOptimizer")
+        .def(py::init([](const MinCurvatureParams& params, const std::size_t num_threads) {
+            auto batch_params = std::make_unique<BatchOptimizerParams>();
+            batch_params->num_threads = num_threads;
+            batch_params->optimizer = params;
+            return std::make_unique<BatchOptimizer>(std::move(batch_params));
+        }), py::arg("params") = MinCurvatureParams(), py::arg("num_threads") = 4)
+        // Corridors are (centerline, left_boundary, right_boundary) tuples of (N, 2) arrays
+        .def("solve_batch", [](BatchOptimizer& self, const py::sequence& corridors,
+                               const double weight, const double last_point_shrink) {
+            std::vector<CorridorRequest> requests(corridors.size());
+            for (std::size_t i = 0; i < requests.size(); ++i) {
+                const py::sequence corridor = corridors[i];
+                if (corridor.size() != 3) {
+                    throw py::value_error("Corridors are (centerline, left_boundary, right_boundary) tuples.");
+                }
+                requests[i].centerline = toVector(corridor[0]);
+                requests[i].left_boundary = toVector(corridor[1]);
+                requests[i].right_boundary = toVector(corridor[2]);
+                requests[i].weight = weight;
+                requests[i].last_point_shrink = last_point_shrink;
+            }
+            py::gil_scoped_release release;
+            return self.solveBatch(requests);
+        }, py::arg("corridors"), py::arg("weight") = 0.5, py::arg("last_point_shrink") = 0.5)
+        // Candidates are (N, 2) arrays of left and right widths along the normals of the reference
+        .def("solve_candidates", [](BatchOptimizer& self, const std::shared_ptr<BaseCubicSpline>& reference,
+                                    const std::vector<Eigen::MatrixXd>& widths, const double last_point_shrink) {
+            std::vector<CandidateCorridor> candidates(widths.size());
+            for (std::size_t i = 0; i < candidates.size(); ++i) {
+                candidates[i].widths = widths[i];
+            }
+            py::gil_scoped_release release;
+            return self.solveCandidates(reference, candidates, last_point_shrink);
+        }, py::arg("reference"), py::arg("widths"), py::arg("last_point_shrink") = 0.5);
+}
@@ -24,4 +24,8 @@ const std::size_t& BaseCubicSpline::degree() const{
 const std::vector<Eigen::Vector2d>& BaseCubicSpline::getControlPoints() const{
     return control_points_;
 }
+
+const Eigen::VectorXd BaseCubicSpline::getParameterSpacing() const{
+    return Eigen::VectorXd::Ones(control_points_.size() > 0 ? control_points_.size() - 1 : 0);
+}
 }// namespace spline
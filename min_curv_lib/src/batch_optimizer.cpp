@@ -0,0 +1,244 @@
+#include <algorithm>
+
+#include "min_curv_lib/batch_optimizer.hpp"
+#include "min_curv_lib/cubic_spline.hpp"
+
+namespace spline {
+namespace optimization {
+
+BatchOptimizer::BatchOptimizer() {
+    params_ = std::make_unique<BatchOptimizerParams>();
+    initialize();
+}
+
+BatchOptimizer::BatchOptimizer(std::unique_ptr<BatchOptimizerParams> params) : params_(std::move(params)) {
+    initialize();
+}
+
+BatchOptimizer::~BatchOptimizer() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    queue_cv_.notify_all();
+    if (dispatcher_.joinable()) {
+        dispatcher_.join();
+    }
+    // Fail whatever is still queued so that no caller waits forever
+    for (auto& pending : queue_) {
+        CorridorResult result;
+        result.message = "Batch optimizer shut down before the request was solved.";
+        pending.promise.set_value(result);
+    }
+}
+
+void BatchOptimizer::initialize() {
+    params_->num_threads = std::max<std::size_t>(1, params_->num_threads);
+    params_->max_batch_size = std::max<std::size_t>(1, params_->max_batch_size);
+    // Workers share the parameters but must not all write the same checkpoint
+    MinCurvatureParams worker_params = params_->optimizer;
+    worker_params.checkpoint_file.clear();
+    for (std::size_t i = 0; i < params_->num_threads; ++i) {
+        optimizers_.push_back(std::make_unique<MinCurvatureOptimizer>(
+            std::make_unique<MinCurvatureParams>(worker_params)));
+    }
+    dispatcher_ = std::thread(&BatchOptimizer::dispatchLoop, this);
+}
+
+std::future<CorridorResult> BatchOptimizer::submit(const CorridorRequest& request) {
+    PendingRequest pending;
+    pending.request = request;
+    pending.arrival = std::chrono::high_resolution_clock::now();
+    auto future = pending.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.push_back(std::move(pending));
+    }
+    queue_cv_.notify_one();
+    return future;
+}
+
+void BatchOptimizer::dispatchLoop() {
+    const auto window = std::chrono::duration<double, std::milli>(params_->batch_window);
+    while (true) {
+        std::vector<PendingRequest> batch;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+            if (!running_) {
+                return;
+            }
+            // Keep collecting until the window of the oldest request closes or the batch is full
+            const auto deadline = queue_.front().arrival + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(window);
+            queue_cv_.wait_until(lock, deadline, [this] {
+                return !running_ || queue_.size() >= params_->max_batch_size;
+            });
+            if (!running_) {
+                return;
+            }
+            const std::size_t batch_size = std::min(queue_.size(), params_->max_batch_size);
+            for (std::size_t i = 0; i < batch_size; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        std::vector<CorridorRequest> requests;
+        requests.reserve(batch.size());
+        for (const auto& pending : batch) {
+            requests.push_back(pending.request);
+        }
+        auto results = solveBatch(requests);
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            results[i].queue_time = std::chrono::duration<double, std::milli>(start - batch[i].arrival).count();
+            batch[i].promise.set_value(std::move(results[i]));
+        }
+    }
+}
+
+std::vector<CorridorResult> BatchOptimizer::solveBatch(const std::vector<CorridorRequest>& requests) {
+    std::vector<CorridorResult> results(requests.size());
+    if (requests.empty()) {
+        return results;
+    }
+
+    std::lock_guard<std::mutex> lock(solve_mutex_);
+    std::atomic<std::size_t> next_request{0};
+    auto worker = [&](MinCurvatureOptimizer& optimizer) {
+        for (std::size_t i = next_request++; i < requests.size(); i = next_request++) {
+            results[i] = solveRequest(requests[i], optimizer);
+            results[i].batch_size = requests.size();
+        }
+    };
+
+    // The calling thread works too, so a single request never spawns a thread
+    const std::size_t num_workers = std::min(params_->num_threads, requests.size());
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < num_workers; ++t) {
+        threads.emplace_back(worker, std::ref(*optimizers_[t]));
+    }
+    worker(*optimizers_[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+std::vector<CandidateResult> BatchOptimizer::solveCandidates(const std::shared_ptr<BaseCubicSpline>& ref_spline,
+                                                             const std::vector<CandidateCorridor>& candidates,
+                                                             const double last_point_shrink) {
+    std::vector<CandidateResult> results(candidates.size());
+    if (candidates.empty()) {
+        return results;
+    }
+
+    std::lock_guard<std::mutex> lock(solve_mutex_);
+    ReferenceSetup reference;
+    const auto start = std::chrono::high_resolution_clock::now();
+    try {
+        if (params_->optimizer.constant_system_matrix && ref_spline->size() != params_->optimizer.num_control_points) {
+            throw std::invalid_argument("Reference size does not match num_control_points of the constant system matrix.");
+        }
+        reference = optimizers_[0]->setUpReference(ref_spline);
+    } catch (const std::exception& e) {
+        for (auto& result : results) {
+            result.message = e.what();
+        }
+        return results;
+    }
+    const double reference_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::atomic<std::size_t> next_candidate{0};
+    auto worker = [&](MinCurvatureOptimizer& optimizer) {
+        for (std::size_t i = next_candidate++; i < candidates.size(); i = next_candidate++) {
+            CandidateResult& result = results[i];
+            result.reference_time = reference_time;
+            try {
+                std::shared_ptr<BaseCubicSpline> opt_traj = std::make_shared<ParametricCubicSpline>();
+                auto begin = std::chrono::high_resolution_clock::now();
+                optimizer.setUp(reference, candidates[i], last_point_shrink);
+                auto end = std::chrono::high_resolution_clock::now();
+                result.setup_time = std::chrono::duration<double, std::milli>(end - begin).count();
+                begin = end;
+                optimizer.solve(opt_traj);
+                end = std::chrono::high_resolution_clock::now();
+                result.solve_time = std::chrono::duration<double, std::milli>(end - begin).count();
+                result.control_points = opt_traj->getControlPoints();
+                result.status = optimizer.getStatus();
+                result.success = result.status == SolveStatus::Solved;
+                // An infeasible or unfinished candidate must never look best
+                if (result.success) {
+                    result.objective = optimizer.getObjective();
+                } else {
+                    result.message = toString(result.status);
+                }
+            } catch (const std::exception& e) {
+                result.message = e.what();
+            }
+        }
+    };
+
+    const std::size_t num_workers = std::min(params_->num_threads, candidates.size());
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < num_workers; ++t) {
+        threads.emplace_back(worker, std::ref(*optimizers_[t]));
+    }
+    worker(*optimizers_[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+CorridorResult BatchOptimizer::solveRequest(const CorridorRequest& request, MinCurvatureOptimizer& optimizer) const {
+    CorridorResult result;
+    const std::size_t num_points = request.centerline.size();
+    if (num_points < 3 || request.left_boundary.size() != num_points || request.right_boundary.size() != num_points) {
+        result.message = "Centerline and boundaries must have the same size (at least 3 points).";
+        return result;
+    }
+    if (params_->optimizer.constant_system_matrix && num_points != params_->optimizer.num_control_points) {
+        result.message = "Corridor size does not match num_control_points of the constant system matrix.";
+        return result;
+    }
+
+    try {
+        auto ref_spline = std::make_shared<ParametricCubicSpline>(request.centerline);
+        auto left_spline = std::make_shared<ParametricCubicSpline>(request.left_boundary);
+        auto right_spline = std::make_shared<ParametricCubicSpline>(request.right_boundary);
+        std::shared_ptr<BaseCubicSpline> opt_traj = std::make_shared<ParametricCubicSpline>();
+        optimizer.setSplines(ref_spline, left_spline, right_spline);
+
+        // Same two pass scheme as the ROS wrapper
+        auto start = std::chrono::high_resolution_clock::now();
+        optimizer.setUp(request.last_point_shrink);
+        auto end = std::chrono::high_resolution_clock::now();
+        result.setup_time += std::chrono::duration<double, std::milli>(end - start).count();
+        start = end;
+        optimizer.solve(opt_traj, request.weight);
+        end = std::chrono::high_resolution_clock::now();
+        result.solve_time += std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = end;
+        optimizer.setUp(request.last_point_shrink);
+        end = std::chrono::high_resolution_clock::now();
+        result.setup_time += std::chrono::duration<double, std::milli>(end - start).count();
+        start = end;
+        optimizer.solve(opt_traj, 1 - request.weight);
+        end = std::chrono::high_resolution_clock::now();
+        result.solve_time += std::chrono::duration<double, std::milli>(end - start).count();
+
+        result.control_points = opt_traj->getControlPoints();
+        result.success = optimizer.getStatus() == SolveStatus::Solved;
+        if (!result.success) {
+            result.message = toString(optimizer.getStatus());
+        }
+    } catch (const std::exception& e) {
+        result.message = e.what();
+    }
+    return result;
+}
+
+} // namespace optimization
+} // namespace spline
@@ -0,0 +1,58 @@
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "min_curv_lib/control_point_placement.hpp"
+
+namespace spline {
+
+const ControlPointPlacement placeControlPoints(const BaseCubicSpline& reference,
+                                               const std::size_t num_control_points,
+                                               const double curvature_gain,
+                                               const std::size_t num_samples) {
+    if (num_control_points < 3 || num_samples < num_control_points) {
+        throw std::invalid_argument("Need at least 3 control points and more samples than control points.");
+    }
+
+    // Cumulative density along the reference, integrated with the trapezoidal rule
+    std::vector<double> u(num_samples), density(num_samples), cumulative(num_samples, 0.0);
+    Eigen::Vector2d previous_point = reference.evaluateSpline(0.0, 0);
+    for (std::size_t k = 0; k < num_samples; ++k) {
+        u[k] = static_cast<double>(k) / (num_samples - 1);
+        const Eigen::Vector2d point = reference.evaluateSpline(u[k], 0);
+        density[k] = 1.0 + curvature_gain * reference.computeCurvature(u[k]);
+        if (k > 0) {
+            const double ds = (point - previous_point).norm();
+            cumulative[k] = cumulative[k - 1] + 0.5 * (density[k] + density[k - 1]) * ds;
+        }
+        previous_point = point;
+    }
+
+    // Equal shares of the cumulative density per segment
+    ControlPointPlacement placement;
+    placement.control_points.resize(num_control_points);
+    placement.knots.resize(num_control_points);
+    std::size_t k = 0;
+    for (std::size_t j = 0; j < num_control_points; ++j) {
+        const double target = cumulative.back() * j / (num_control_points - 1);
+        while (k + 2 < num_samples && cumulative[k + 1] < target) {
+            ++k;
+        }
+        const double span = cumulative[k + 1] - cumulative[k];
+        const double t = span > 0.0 ? std::min(1.0, std::max(0.0, (target - cumulative[k]) / span)) : 0.0;
+        placement.control_points[j] = reference.evaluateSpline(u[k] + t * (u[k + 1] - u[k]), 0);
+    }
+
+    // Chord length knots scaled to a mean spacing of one, uniform input keeps unit spacing
+    placement.knots[0] = 0.0;
+    for (std::size_t j = 1; j < num_control_points; ++j) {
+        placement.knots[j] = placement.knots[j - 1] + std::max(1e-9, (placement.control_points[j] - placement.control_points[j - 1]).norm());
+    }
+    const double scale = (num_control_points - 1) / placement.knots.back();
+    for (auto& knot : placement.knots) {
+        knot *= scale;
+    }
+    return placement;
+}
+
+} // namespace spline
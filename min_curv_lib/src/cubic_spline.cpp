@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "min_curv_lib/cubic_spline.hpp"
 
 namespace spline {
@@ -9,6 +11,30 @@ ParametricCubicSpline::ParametricCubicSpline(const std::vector<Eigen::Vector2d>&
     initialize();
 }
 
+ParametricCubicSpline::ParametricCubicSpline(const std::vector<Eigen::Vector2d>& control_points, const std::vector<double>& knots)
+    : BaseCubicSpline() {
+    setControlPoints(control_points, knots);
+}
+
+void ParametricCubicSpline::setControlPoints(const std::vector<Eigen::Vector2d>& control_points) {
+    knots_.clear();
+    BaseCubicSpline::setControlPoints(control_points);
+}
+
+void ParametricCubicSpline::setControlPoints(const std::vector<Eigen::Vector2d>& control_points, const std::vector<double>& knots) {
+    if (knots.size() != control_points.size()) {
+        throw std::invalid_argument("There must be one knot per control point.");
+    }
+    for (std::size_t i = 1; i < knots.size(); ++i) {
+        if (knots[i] <= knots[i - 1]) {
+            throw std::invalid_argument("Knots must be strictly increasing.");
+        }
+    }
+    knots_ = knots;
+    control_points_ = control_points;
+    initialize();
+}
+
 // Evaluate the parametric spline at t (0 <= t <= 1)
 const Eigen::Vector2d ParametricCubicSpline::evaluateSpline(const double u, const std::size_t derivative_order) const {
     std::size_t i;
@@ -48,7 +74,14 @@ const double ParametricCubicSpline::computeCurvature(const double u) const {
 
 void ParametricCubicSpline::initialize() {
     const std::size_t num_control_points = control_points_.size();
-    Eigen::VectorXd h = Eigen::VectorXd::Ones(num_control_points - 1);
+    // Without explicit knots every segment spans one unit of parameter
+    if (knots_.size() != num_control_points) {
+        knots_.resize(num_control_points);
+        for (std::size_t i = 0; i < num_control_points; ++i) {
+            knots_[i] = static_cast<double>(i);
+        }
+    }
+    const Eigen::VectorXd h = getParameterSpacing();
     std::vector<Eigen::Vector2d> alpha(num_control_points - 1), z(num_control_points);
     std::vector<double> l(num_control_points), mu(num_control_points);
 
@@ -108,14 +141,27 @@ void ParametricCubicSpline::getIntervalAndLocalT(const double u, std::size_t &i,
         throw std::out_of_range("t must be in the range [0, 1].");
     }
 
-    // Convert t from [0, 1] to the spline parameter in [0, n-1]
+    // Convert t from [0, 1] to the spline parameter in [t_0, t_{n-1}]
     const std::size_t n = control_points_.size();
-    double scaled_u = u * static_cast<double>(n - 1);
-    i = static_cast<std::size_t>(scaled_u);
+    double scaled_u = knots_.front() + u * (knots_.back() - knots_.front());
+    const auto upper = std::upper_bound(knots_.begin(), knots_.end(), scaled_u);
+    i = upper == knots_.begin() ? 0 : static_cast<std::size_t>(upper - knots_.begin()) - 1;
     if (i >= n - 1) {
         i = n - 2;  // Ensure we don't exceed bounds
     }
-    local_u = scaled_u - i;
+    local_u = scaled_u - knots_[i];
+}
+
+const Eigen::VectorXd ParametricCubicSpline::getParameterSpacing() const {
+    Eigen::VectorXd spacing(knots_.size() > 0 ? knots_.size() - 1 : 0);
+    for (std::size_t i = 0; i + 1 < knots_.size(); ++i) {
+        spacing(i) = knots_[i + 1] - knots_[i];
+    }
+    return spacing;
+}
+
+const std::vector<double>& ParametricCubicSpline::getKnots() const {
+    return knots_;
 }
 
 const std::pair<Eigen::MatrixXd, Eigen::MatrixXd> ParametricCubicSpline::getCoefficients() const {
@@ -1,26 +1,178 @@
 #include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <algorithm>
 
 #include "min_curv_lib/curv_min.hpp"
+#include "min_curv_lib/cubic_spline.hpp"
 
 namespace spline {
 namespace optimization {
 
+const std::string toString(const SolveStatus status) {
+    switch (status) {
+    case SolveStatus::Solved:
+        return "solved";
+    case SolveStatus::MaxIterations:
+        return "OSQP reached the iteration limit";
+    default:
+        return "OSQP failed or the problem is infeasible";
+    }
+}
+
 MinCurvatureOptimizer::MinCurvatureOptimizer(){
     params_ = std::make_unique<MinCurvatureParams>();
     initSolver();
-    // Set up the system matrix inverse if it is constant
-    if (params_->constant_system_matrix) {
+    loadCheckpoint();
+    // Set up the system matrix inverse if it is constant, the sparse formulation never inverts it
+    if (params_->constant_system_matrix && params_->formulation == QPFormulation::DenseSpline &&
+        static_cast<std::size_t>(system_inverse_.rows()) != 4 * params_->num_control_points) {
         setSystemMatrixInverse(params_->num_control_points);
     }
+    if (params_->use_cache) {
+        cache_ = std::make_unique<SolutionCache>(params_->cache_size, params_->cache_quantization);
+    }
 }
 
 MinCurvatureOptimizer::MinCurvatureOptimizer(std::unique_ptr<MinCurvatureParams> params) : params_(std::move(params)) {
     initSolver();
-    // Set up the system matrix inverse if it is constant
-    if (params_->constant_system_matrix) {
+    loadCheckpoint();
+    // Set up the system matrix inverse if it is constant, the sparse formulation never inverts it
+    if (params_->constant_system_matrix && params_->formulation == QPFormulation::DenseSpline &&
+        static_cast<std::size_t>(system_inverse_.rows()) != 4 * params_->num_control_points) {
         setSystemMatrixInverse(params_->num_control_points);
     }
+    if (params_->use_cache) {
+        cache_ = std::make_unique<SolutionCache>(params_->cache_size, params_->cache_quantization);
+    }
+}
+
+MinCurvatureOptimizer::MinCurvatureOptimizer(std::unique_ptr<MinCurvatureParams> params, const Eigen::MatrixXd& system_inverse)
+    : params_(std::move(params)) {
+    initSolver();
+    if (system_inverse.rows() != static_cast<Eigen::Index>(4 * params_->num_control_points) ||
+        system_inverse.cols() != system_inverse.rows()) {
+        throw std::invalid_argument("System matrix inverse does not match the number of control points.");
+    }
+    system_inverse_ = system_inverse;
+    loadCheckpoint();
+    if (params_->use_cache) {
+        cache_ = std::make_unique<SolutionCache>(params_->cache_size, params_->cache_quantization);
+    }
+}
+
+MinCurvatureOptimizer::~MinCurvatureOptimizer() {
+    if (solves_since_checkpoint_ > 0) {
+        saveCheckpoint();
+    }
+}
+
+namespace {
+constexpr char kCheckpointMagic[8] = {'M', 'C', 'C', 'K', 'P', 'T', '\0', '\0'};
+constexpr std::uint32_t kCheckpointVersion = 1;
+
+void writeVector(std::ofstream& file, const Eigen::VectorXd& vector) {
+    const std::uint64_t size = vector.size();
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(vector.data()), size * sizeof(double));
+}
+
+const bool readVector(std::ifstream& file, Eigen::VectorXd& vector, const std::uint64_t max_size) {
+    std::uint64_t size;
+    if (!file.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > max_size) {
+        return false;
+    }
+    vector.resize(size);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(vector.data()), size * sizeof(double)));
+}
+} // namespace
+
+void MinCurvatureOptimizer::loadCheckpoint() {
+    if (params_->checkpoint_file.empty()) {
+        return;
+    }
+    std::ifstream file(params_->checkpoint_file, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    // Layout: magic, version, formulation, inverse size and column-major data, primal, dual
+    char magic[8];
+    std::uint32_t version, formulation;
+    std::uint64_t inverse_size;
+    if (!file.read(magic, sizeof(magic)) || std::char_traits<char>::compare(magic, kCheckpointMagic, sizeof(magic)) != 0 ||
+        !file.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != kCheckpointVersion ||
+        !file.read(reinterpret_cast<char*>(&formulation), sizeof(formulation)) ||
+        formulation != static_cast<std::uint32_t>(params_->formulation) ||
+        !file.read(reinterpret_cast<char*>(&inverse_size), sizeof(inverse_size)) ||
+        (inverse_size != 0 && inverse_size != 4 * params_->num_control_points)) {
+        std::cerr << "Ignoring incompatible checkpoint " << params_->checkpoint_file << ", starting cold\n";
+        return;
+    }
+    // Nothing is allocated before the header is known to fit the file, a corrupt size must not
+    // end in a huge allocation
+    const std::streamoff header_end = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::uint64_t remaining = static_cast<std::uint64_t>(file.tellg() - header_end);
+    file.seekg(header_end);
+    const std::uint64_t inverse_bytes = inverse_size * inverse_size * sizeof(double);
+    if (remaining < inverse_bytes + 2 * sizeof(std::uint64_t)) {
+        std::cerr << "Ignoring truncated checkpoint " << params_->checkpoint_file << ", starting cold\n";
+        return;
+    }
+    try {
+        Eigen::MatrixXd system_inverse(inverse_size, inverse_size);
+        Eigen::VectorXd primal, dual;
+        const std::uint64_t max_size = (remaining - inverse_bytes) / sizeof(double);
+        if (!file.read(reinterpret_cast<char*>(system_inverse.data()), inverse_bytes) ||
+            !readVector(file, primal, max_size) || !readVector(file, dual, max_size)) {
+            std::cerr << "Ignoring truncated checkpoint " << params_->checkpoint_file << ", starting cold\n";
+            return;
+        }
+        // An explicitly given inverse has priority, a stored one is only used for the configured size
+        if (system_inverse_.size() == 0 && params_->constant_system_matrix && inverse_size != 0) {
+            system_inverse_ = std::move(system_inverse);
+        }
+        last_primal_ = std::move(primal);
+        last_dual_ = std::move(dual);
+    } catch (const std::exception& e) {
+        std::cerr << "Could not load checkpoint " << params_->checkpoint_file << " (" << e.what() << "), starting cold\n";
+        last_primal_.resize(0);
+        last_dual_.resize(0);
+    }
+}
+
+const bool MinCurvatureOptimizer::saveCheckpoint() const {
+    if (params_->checkpoint_file.empty()) {
+        return false;
+    }
+    // Write next to the checkpoint and rename, a crash while writing never leaves a torn file behind
+    const std::string temporary_file = params_->checkpoint_file + ".tmp";
+    {
+        std::ofstream file(temporary_file, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        const std::uint32_t formulation = static_cast<std::uint32_t>(params_->formulation);
+        // Only the constant inverse is worth storing, the others change with every reference
+        const bool store_inverse = params_->constant_system_matrix && params_->formulation == QPFormulation::DenseSpline;
+        const std::uint64_t inverse_size = store_inverse ? system_inverse_.rows() : 0;
+        file.write(kCheckpointMagic, sizeof(kCheckpointMagic));
+        file.write(reinterpret_cast<const char*>(&kCheckpointVersion), sizeof(kCheckpointVersion));
+        file.write(reinterpret_cast<const char*>(&formulation), sizeof(formulation));
+        file.write(reinterpret_cast<const char*>(&inverse_size), sizeof(inverse_size));
+        if (store_inverse) {
+            file.write(reinterpret_cast<const char*>(system_inverse_.data()), system_inverse_.size() * sizeof(double));
+        }
+        writeVector(file, last_primal_);
+        writeVector(file, last_dual_);
+        if (!file) {
+            return false;
+        }
+    }
+    return std::rename(temporary_file.c_str(), params_->checkpoint_file.c_str()) == 0;
 }
 
 void MinCurvatureOptimizer::initSolver() {
@@ -29,6 +181,8 @@ void MinCurvatureOptimizer::initSolver() {
     solver_->settings()->setVerbosity(params_->verbose);
     solver_->settings()->setMaxIteration(params_->max_num_iterations); 
     solver_->settings()->setWarmStart(params_->warm_start);
+    solver_->settings()->setAbsoluteTolerance(params_->eps_abs);
+    solver_->settings()->setRelativeTolerance(params_->eps_rel);
 }
 
 void MinCurvatureOptimizer::setSplines(const std::shared_ptr<BaseCubicSpline>& ref_spline,
@@ -37,64 +191,203 @@ void MinCurvatureOptimizer::setSplines(const std::shared_ptr<BaseCubicSpline>& r
     ref_spline_ = ref_spline;
     left_spline_ = left_spline;
     right_spline_ = right_spline;
+    corridor_widths_.resize(0, 2);
+    distance_field_.reset();
+}
+
+void MinCurvatureOptimizer::setCorridor(const std::shared_ptr<BaseCubicSpline>& ref_spline, const Eigen::MatrixXd& widths) {
+    if (widths.cols() != 2 || (widths.array() < 0.0).any()) {
+        throw std::invalid_argument("Corridor widths must be N x 2 (left, right) and non-negative.");
+    }
+    ref_spline_ = ref_spline;
+    left_spline_ = nullptr;
+    right_spline_ = nullptr;
+    corridor_widths_ = widths;
+    distance_field_.reset();
+}
+
+void MinCurvatureOptimizer::setDistanceField(const std::shared_ptr<BaseCubicSpline>& ref_spline,
+                                             const std::shared_ptr<const DistanceField>& field) {
+    if (!field || field->empty()) {
+        throw std::invalid_argument("Distance field corridor needs a non-empty field.");
+    }
+    ref_spline_ = ref_spline;
+    left_spline_ = nullptr;
+    right_spline_ = nullptr;
+    corridor_widths_.resize(0, 2);
+    distance_field_ = field;
+}
+
+void MinCurvatureOptimizer::setFixedDisplacements(const Eigen::MatrixXd& displacements) {
+    fixed_displacements_ = displacements;
+}
+
+void MinCurvatureOptimizer::setWarmUp(const bool warm_up) {
+    if (warm_up == warm_up_) {
+        return;
+    }
+    warm_up_ = warm_up;
+    if (warm_up) {
+        warm_up_primal_ = last_primal_;
+        warm_up_dual_ = last_dual_;
+        warm_up_fast_path_stats_ = fast_path_stats_;
+    } else {
+        last_primal_ = std::move(warm_up_primal_);
+        last_dual_ = std::move(warm_up_dual_);
+        fast_path_stats_ = warm_up_fast_path_stats_;
+    }
 }
 
 void MinCurvatureOptimizer::setUp(const double last_point_shrink) {
     auto start = std::chrono::high_resolution_clock::now();
-    setupQP(last_point_shrink);
+    if (!lookUpCache(last_point_shrink)) {
+        setupQP(last_point_shrink);
+    }
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    setup_time_ = std::chrono::duration<double, std::milli>(end - start).count();
     if (params_->verbose) {
-        std::cout << "Setup time: " << duration.count() << "ms\n";
+        std::cout << "Setup time: " << duration.count() << "ms" << (cache_hit_ ? " (cache hit)" : "") << "\n";
+    }
+}
+
+const bool MinCurvatureOptimizer::lookUpCache(const double last_point_shrink) {
+    cache_hit_ = false;
+    // Without a key of the current problem solve() must not insert, a stale key would serve another corridor
+    cache_key_.clear();
+    // A key over the whole grid would cost more than the lookup saves, pinned points are not part of the key
+    if (!cache_ || warm_up_ || distance_field_ || fixed_displacements_.rows() > 0) {
+        return false;
+    }
+    // Widths take the place of the left boundary, the empty right boundary keeps the keys of both modes apart
+    std::vector<Eigen::Vector2d> widths(corridor_widths_.rows());
+    for (Eigen::Index i = 0; i < corridor_widths_.rows(); ++i) {
+        widths[i] = corridor_widths_.row(i).transpose();
+    }
+    cache_key_ = cache_->makeKey(ref_spline_->getControlPoints(),
+                                 left_spline_ ? left_spline_->getControlPoints() : widths,
+                                 right_spline_ ? right_spline_->getControlPoints() : std::vector<Eigen::Vector2d>(),
+                                 {last_point_shrink, params_->shrink,
+                                  static_cast<double>(params_->num_nearest),
+                                  static_cast<double>(params_->num_points_evaluate)});
+    const CachedSolution* cached = cache_->find(cache_key_);
+    if (cached == nullptr) {
+        return false;
+    }
+    cached_solution_ = *cached;
+    normal_vectors_ = cached_solution_.normal_vectors;
+    cache_hit_ = true;
+    return true;
+}
+
+const double FastPathStats::hitRate() const {
+    const std::size_t attempts = hits + misses;
+    return attempts == 0 ? 0.0 : static_cast<double>(hits) / attempts;
+}
+
+const FastPathStats& MinCurvatureOptimizer::getFastPathStats() const {
+    return fast_path_stats_;
+}
+
+const CacheStats MinCurvatureOptimizer::getCacheStats() const {
+    return cache_ ? cache_->getStats() : CacheStats();
+}
+
+const Eigen::MatrixXd& MinCurvatureOptimizer::getSystemMatrixInverse() const {
+    return system_inverse_;
+}
+
+const QPProblem MinCurvatureOptimizer::getProblem() const {
+    if (params_->formulation != QPFormulation::DenseSpline) {
+        return {P_sparse_, q_sparse_, A_sparse_, sparse_lower_bound_, sparse_upper_bound_};
+    }
+    return {toSparseMatrix(H_), c_, toSparseMatrix(A_), lower_bound_, upper_bound_};
+}
+
+const Eigen::VectorXd& MinCurvatureOptimizer::getSolution() const {
+    return solution_;
+}
+
+const Eigen::MatrixXd& MinCurvatureOptimizer::getNormalVectors() const {
+    return normal_vectors_;
+}
+
+const std::size_t MinCurvatureOptimizer::getIterations() const {
+    return last_iterations_;
+}
+
+const SolveStatus MinCurvatureOptimizer::getStatus() const {
+    return status_;
+}
+
+const double MinCurvatureOptimizer::getObjective() const {
+    if (params_->formulation != QPFormulation::DenseSpline || solution_.size() != c_.size()) {
+        return std::numeric_limits<double>::quiet_NaN();
     }
+    return 0.5 * solution_.dot(H_ * solution_) + c_.dot(solution_);
 }
 
 void MinCurvatureOptimizer::setSystemMatrixInverse(const std::size_t size) {
+    setSystemMatrixInverse(Eigen::VectorXd::Ones(size - 1));
+}
+
+void MinCurvatureOptimizer::setSystemMatrixInverse(const Eigen::VectorXd& spacing) {
+    const Eigen::SparseMatrix<double> system_matrix_sparse = getSystemMatrix(spacing);
+    const std::size_t size_system = system_matrix_sparse.rows();
+
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+    solver.analyzePattern(system_matrix_sparse);  // Analyze the sparsity pattern
+    solver.factorize(system_matrix_sparse);       // Factorize the matrix
+    // Now solve for the inverse
+    Eigen::SparseMatrix<double> identity(size_system, size_system);
+    identity.setIdentity();  // Create an identity matrix of size NxN
+    // Solve for the inverse by treating it as a linear system
+    Eigen::SparseMatrix<double> A_inv_sparse = solver.solve(identity);
+    system_inverse_ = fromSparseMatrix(A_inv_sparse);
+}
+
+const Eigen::SparseMatrix<double> MinCurvatureOptimizer::getSystemMatrix(const Eigen::VectorXd& spacing) const {
+    // Segment i spans h_i = spacing(i) units of parameter
+    const std::size_t size = spacing.size() + 1;
     const std::size_t size_system = 4 * size;
     Eigen::SparseMatrix<double> system_matrix_sparse(size_system, size_system);
+    const double h_0 = spacing(0);
     system_matrix_sparse.insert(0, 0) = 1.;
     system_matrix_sparse.insert(1, 2) = 2.;
     system_matrix_sparse.insert(2, 0) = 1.;
-    system_matrix_sparse.insert(2, 1) = 1.;
-    system_matrix_sparse.insert(2, 2) = 1.;
-    system_matrix_sparse.insert(2, 3) = 1.;
+    system_matrix_sparse.insert(2, 1) = h_0;
+    system_matrix_sparse.insert(2, 2) = h_0 * h_0;
+    system_matrix_sparse.insert(2, 3) = h_0 * h_0 * h_0;
     system_matrix_sparse.insert(3, 1) = 1.;
-    system_matrix_sparse.insert(3, 2) = 2.;
-    system_matrix_sparse.insert(3, 3) = 3.;
+    system_matrix_sparse.insert(3, 2) = 2. * h_0;
+    system_matrix_sparse.insert(3, 3) = 3. * h_0 * h_0;
     system_matrix_sparse.insert(3, 5) = -1.;
     system_matrix_sparse.insert(4, 2) = 1.;
-    system_matrix_sparse.insert(4, 3) = 3.;
+    system_matrix_sparse.insert(4, 3) = 3. * h_0;
     system_matrix_sparse.insert(4, 6) = -1.;
     system_matrix_sparse.insert(size_system - 3, size_system - 4) = 1;
     system_matrix_sparse.insert(size_system - 2, size_system - 2) = 2;
     system_matrix_sparse.insert(size_system - 1, size_system - 1) = 1;
     for (std::size_t i = 1; i < size - 1; ++i) {
+        const double h = spacing(i);
         system_matrix_sparse.insert(4*i+1, 4*i) = 1.;
         system_matrix_sparse.insert(4*i+2, 4*i) = 1.;
-        system_matrix_sparse.insert(4*i+2, 4*i+1) = 1.;
-        system_matrix_sparse.insert(4*i+2, 4*i+2) = 1.;
-        system_matrix_sparse.insert(4*i+2, 4*i+3) = 1.;
+        system_matrix_sparse.insert(4*i+2, 4*i+1) = h;
+        system_matrix_sparse.insert(4*i+2, 4*i+2) = h * h;
+        system_matrix_sparse.insert(4*i+2, 4*i+3) = h * h * h;
         system_matrix_sparse.insert(4*i+3, 4*i+1) = 1.;
-        system_matrix_sparse.insert(4*i+3, 4*i+2) = 2.;
-        system_matrix_sparse.insert(4*i+3, 4*i+3) = 3.;
+        system_matrix_sparse.insert(4*i+3, 4*i+2) = 2. * h;
+        system_matrix_sparse.insert(4*i+3, 4*i+3) = 3. * h * h;
         system_matrix_sparse.insert(4*i+3, 4*i+5) = -1.;
         system_matrix_sparse.insert(4*i+4, 4*i+2) = 1.;
-        system_matrix_sparse.insert(4*i+4, 4*i+3) = 3.;
+        system_matrix_sparse.insert(4*i+4, 4*i+3) = 3. * h;
         system_matrix_sparse.insert(4*i+4, 4*i+6) = -1.;
     }
-
-    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
-    solver.analyzePattern(system_matrix_sparse);  // Analyze the sparsity pattern
-    solver.factorize(system_matrix_sparse);       // Factorize the matrix
-    // Now solve for the inverse
-    Eigen::SparseMatrix<double> identity(size_system, size_system);
-    identity.setIdentity();  // Create an identity matrix of size NxN
-    // Solve for the inverse by treating it as a linear system
-    Eigen::SparseMatrix<double> A_inv_sparse = solver.solve(identity);
-    system_inverse_ = fromSparseMatrix(A_inv_sparse);
+    system_matrix_sparse.makeCompressed();
+    return system_matrix_sparse;
 }
 
-void MinCurvatureOptimizer::computeHessianAndLinear() {
+void MinCurvatureOptimizer::computeNormalVectors() {
     // Get normal vectors from coefficients 
     // Normal vector is the derivative of the spline, wich are coefficients b
     const std::size_t num_control_points = ref_spline_->size();
@@ -105,6 +398,11 @@ void MinCurvatureOptimizer::computeHessianAndLinear() {
 
     // Normalization of normal vectors
     normal_vectors_.rowwise().normalize();
+}
+
+void MinCurvatureOptimizer::computeHessianAndLinear() {
+    computeNormalVectors();
+    const std::size_t num_control_points = ref_spline_->size();
 
     // Calculate A matrix (later updated in for loop)
     const std::size_t size_A = 4 * num_control_points;
@@ -150,8 +448,12 @@ void MinCurvatureOptimizer::computeHessianAndLinear() {
     M_y(size_A - 3, num_control_points - 1) = normal_vectors_(num_control_points - 1, 1);
     A_ex(num_control_points - 1, size_A - 2) = 1;
 
-    if (!params_->constant_system_matrix) {
-        setSystemMatrixInverse(num_control_points);
+    // The constant system matrix assumes uniform knots, non-uniform references need their own
+    const Eigen::VectorXd spacing = ref_spline_->getParameterSpacing();
+    const bool uniform_spacing = (spacing.array() - 1.0).abs().maxCoeff() < 1e-9;
+    if (!params_->constant_system_matrix || !uniform_spacing ||
+        static_cast<std::size_t>(system_inverse_.rows()) != 4 * num_control_points) {
+        setSystemMatrixInverse(spacing);
     }
     Eigen::MatrixXd T_c = 2 * A_ex * system_inverse_;
     Eigen::MatrixXd T_nx = T_c * M_x;
@@ -162,10 +464,156 @@ void MinCurvatureOptimizer::computeHessianAndLinear() {
     H_ = (tmp.adjoint() + tmp) / 2;
 }
 
+void MinCurvatureOptimizer::computeSparseProblem() {
+    // Variables are z = [alpha; gamma_x; gamma_y], the lateral offsets and the spline coefficients of both axes.
+    // The continuity conditions S * gamma = q + M * alpha stay as equality constraints instead of
+    // being eliminated through the dense inverse of S, so every matrix keeps O(N) nonzeros.
+    computeNormalVectors();
+    const std::size_t num_control_points = ref_spline_->size();
+    const std::size_t size_A = 4 * num_control_points;
+    const std::size_t num_variables = num_control_points + 2 * size_A;
+    const auto& control_points = ref_spline_->getControlPoints();
+    const Eigen::SparseMatrix<double> system_matrix = getSystemMatrix(ref_spline_->getParameterSpacing());
+
+    // Same q_x, q_y, M_x, M_y and extraction pattern as the dense formulation
+    Eigen::VectorXd q_x = Eigen::VectorXd::Zero(size_A);
+    Eigen::VectorXd q_y = Eigen::VectorXd::Zero(size_A);
+    std::vector<std::pair<std::size_t, std::size_t>> q_rows;  // (row of q/M, control point)
+    q_rows.emplace_back(0, 0);
+    q_rows.emplace_back(2, 1);
+    for (std::size_t i = 1; i < num_control_points - 1; ++i) {
+        q_rows.emplace_back(4 * i + 1, i);
+        q_rows.emplace_back(4 * i + 2, i + 1);
+    }
+    q_rows.emplace_back(size_A - 3, num_control_points - 1);
+    std::vector<std::size_t> second_derivative_cols(num_control_points);
+    second_derivative_cols[0] = 2;
+    for (std::size_t i = 1; i < num_control_points - 1; ++i) {
+        second_derivative_cols[i] = 4 * i + 2;
+    }
+    second_derivative_cols[num_control_points - 1] = size_A - 2;
+
+    // Constraints: continuity for x and y, then the offset bounds
+    computeConstraints(last_point_shrink_);
+    std::vector<Eigen::Triplet<double>> constraint_triplets;
+    constraint_triplets.reserve(2 * system_matrix.nonZeros() + 2 * q_rows.size() + num_control_points);
+    for (std::size_t axis = 0; axis < 2; ++axis) {
+        const std::size_t row_offset = axis * size_A;
+        const std::size_t col_offset = num_control_points + axis * size_A;
+        for (int k = 0; k < system_matrix.outerSize(); ++k) {
+            for (Eigen::SparseMatrix<double>::InnerIterator it(system_matrix, k); it; ++it) {
+                constraint_triplets.emplace_back(row_offset + it.row(), col_offset + it.col(), it.value());
+            }
+        }
+        for (const auto& q_row : q_rows) {
+            constraint_triplets.emplace_back(row_offset + q_row.first, q_row.second, -normal_vectors_(q_row.second, axis));
+        }
+    }
+    for (const auto& q_row : q_rows) {
+        q_x(q_row.first) = control_points[q_row.second].x();
+        q_y(q_row.first) = control_points[q_row.second].y();
+    }
+    for (std::size_t i = 0; i < num_control_points; ++i) {
+        constraint_triplets.emplace_back(2 * size_A + i, i, 1.);
+    }
+    A_sparse_.resize(2 * size_A + num_control_points, num_variables);
+    A_sparse_.setFromTriplets(constraint_triplets.begin(), constraint_triplets.end());
+    sparse_lower_bound_.resize(2 * size_A + num_control_points);
+    sparse_lower_bound_ << q_x, q_y, lower_bound_;
+    sparse_upper_bound_.resize(2 * size_A + num_control_points);
+    sparse_upper_bound_ << q_x, q_y, upper_bound_;
+
+    // Hessian on the coefficients, the second derivatives are 2 * c_i. The weights match
+    // the symmetrized dense Hessian: P_xx and P_yy on the diagonal blocks, P_xy / 2 off diagonal.
+    std::vector<Eigen::Triplet<double>> hessian_triplets;
+    hessian_triplets.reserve(4 * num_control_points);
+    for (std::size_t i = 0; i < num_control_points; ++i) {
+        const double n_x = normal_vectors_(i, 0);
+        const double n_y = normal_vectors_(i, 1);
+        const double square_normal = n_x * n_x + n_y * n_y;
+        const std::size_t col_x = num_control_points + second_derivative_cols[i];
+        const std::size_t col_y = col_x + size_A;
+        hessian_triplets.emplace_back(col_x, col_x, 4. * n_x * n_x / square_normal);
+        hessian_triplets.emplace_back(col_y, col_y, 4. * n_y * n_y / square_normal);
+        hessian_triplets.emplace_back(col_x, col_y, 4. * n_x * n_y / square_normal);
+        hessian_triplets.emplace_back(col_y, col_x, 4. * n_x * n_y / square_normal);
+    }
+    P_sparse_.resize(num_variables, num_variables);
+    P_sparse_.setFromTriplets(hessian_triplets.begin(), hessian_triplets.end());
+
+    // Linear term G * gamma_0 with S * gamma_0 = q, so that the objective equals the dense one up to a constant
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> system_solver;
+    system_solver.compute(system_matrix);
+    Eigen::VectorXd gamma_0(num_variables);
+    gamma_0 << Eigen::VectorXd::Zero(num_control_points), system_solver.solve(q_x), system_solver.solve(q_y);
+    q_sparse_ = P_sparse_ * gamma_0;
+}
+
+void MinCurvatureOptimizer::computeDiscreteProblem() {
+    // Second differences d_i = a_i p_{i-1} + b_i p_i + c_i p_{i+1} of the shifted control points
+    // p_i = r_i + alpha_i n_i, linear in alpha: d = d_0 + D * alpha. Weights follow the knot spacing.
+    computeNormalVectors();
+    computeConstraints(last_point_shrink_);
+    const std::size_t num_control_points = ref_spline_->size();
+    const std::size_t num_differences = num_control_points - 2;
+    const auto& control_points = ref_spline_->getControlPoints();
+    const Eigen::VectorXd spacing = ref_spline_->getParameterSpacing();
+
+    std::vector<Eigen::Triplet<double>> difference_triplets;
+    difference_triplets.reserve(6 * num_differences);
+    Eigen::VectorXd d_0(2 * num_differences);
+    for (std::size_t i = 1; i < num_control_points - 1; ++i) {
+        const double h_prev = spacing(i - 1);
+        const double h_next = spacing(i);
+        const double weights[3] = {2. / (h_prev * (h_prev + h_next)),
+                                   -2. / (h_prev * h_next),
+                                   2. / (h_next * (h_prev + h_next))};
+        Eigen::Vector2d difference = Eigen::Vector2d::Zero();
+        for (std::size_t k = 0; k < 3; ++k) {
+            const std::size_t j = i - 1 + k;
+            difference += weights[k] * control_points[j];
+            difference_triplets.emplace_back(2 * (i - 1), j, weights[k] * normal_vectors_(j, 0));
+            difference_triplets.emplace_back(2 * (i - 1) + 1, j, weights[k] * normal_vectors_(j, 1));
+        }
+        d_0.segment<2>(2 * (i - 1)) = difference;
+    }
+    Eigen::SparseMatrix<double> difference_matrix(2 * num_differences, num_control_points);
+    difference_matrix.setFromTriplets(difference_triplets.begin(), difference_triplets.end());
+
+    // Scaled like the spline formulation: the quadratic term enters OSQP as 1/2 alpha^T H alpha,
+    // with H the quadratic part of the curvature sum, so the two pass weights behave the same
+    P_sparse_ = (difference_matrix.transpose() * difference_matrix).pruned();
+    q_sparse_ = 2 * difference_matrix.transpose() * d_0;
+    A_sparse_.resize(num_control_points, num_control_points);
+    A_sparse_.setIdentity();
+    sparse_lower_bound_ = lower_bound_;
+    sparse_upper_bound_ = upper_bound_;
+}
+
 const Eigen::MatrixXd MinCurvatureOptimizer::getBoundaryDistance() const {
     const std::size_t num_control_points = ref_spline_->size();
     const std::size_t num_points_evaluate = params_->num_points_evaluate;
 
+    // March from every control point along its normal, to the left and to the right
+    if (distance_field_) {
+        Eigen::MatrixXd distance(num_control_points, 2);
+        const auto& control_points = ref_spline_->getControlPoints();
+        for (std::size_t i = 0; i < num_control_points; ++i) {
+            const Eigen::Vector2d normal = normal_vectors_.row(i).transpose();
+            distance(i, 0) = distance_field_->freeDistance(control_points[i], normal, params_->max_corridor_width);
+            distance(i, 1) = distance_field_->freeDistance(control_points[i], -normal, params_->max_corridor_width);
+        }
+        return (distance.array() - params_->shrink).cwiseMax(0.0).matrix();
+    }
+
+    // Widths given by the map are already the distances along the normals
+    if (!left_spline_ || !right_spline_) {
+        if (static_cast<std::size_t>(corridor_widths_.rows()) != num_control_points) {
+            throw std::invalid_argument("There must be one corridor width pair per control point.");
+        }
+        return (corridor_widths_.array() - params_->shrink).cwiseMax(0.0).matrix();
+    }
+
     Eigen::MatrixXd distance(num_control_points, 2);
 
     // Precompute left and right spline points
@@ -253,28 +701,97 @@ void MinCurvatureOptimizer::computeConstraints(const double last_point_shrink) {
     // Set the last control point to have a smaller range
     lower_bound_(num_control_points - 1) = last_point_shrink * lower_bound_(num_control_points - 1);
     upper_bound_(num_control_points - 1) = last_point_shrink * upper_bound_(num_control_points - 1);
+    // Pinned points along this problem's normals, the first point stays on the reference
+    for (std::size_t i = 1; i < std::min<std::size_t>(fixed_displacements_.rows(), num_control_points); ++i) {
+        const double offset = fixed_displacements_.row(i).dot(normal_vectors_.row(i));
+        lower_bound_(i) = upper_bound_(i) = std::clamp(offset, lower_bound_(i), upper_bound_(i));
+    }
 }
 
 void MinCurvatureOptimizer::setupQP(const double last_point_shrink) {
     // Assert that last_point_shrink is in the range [0, 1]
     assert(last_point_shrink >= 0.0 && last_point_shrink <= 1.0);
+    last_point_shrink_ = last_point_shrink;
     solver_->clearSolver();
     solver_->data()->clearHessianMatrix();
     solver_->data()->clearLinearConstraintsMatrix();
+    if (params_->formulation != QPFormulation::DenseSpline) {
+        if (params_->formulation == QPFormulation::SparseSpline) {
+            computeSparseProblem();
+        } else {
+            computeDiscreteProblem();
+        }
+        num_variables_ = P_sparse_.rows();
+        num_constraints_ = A_sparse_.rows();
+        solver_->data()->setNumberOfVariables(num_variables_);
+        solver_->data()->setNumberOfConstraints(num_constraints_);
+        solver_->data()->setHessianMatrix(P_sparse_);
+        solver_->data()->setGradient(q_sparse_);
+        solver_->data()->setLinearConstraintsMatrix(A_sparse_);
+        solver_->data()->setLowerBound(sparse_lower_bound_);
+        solver_->data()->setUpperBound(sparse_upper_bound_);
+        return;
+    }
     computeHessianAndLinear();
     computeConstraints(last_point_shrink);
-    
+    loadDenseProblem();
+}
+
+void MinCurvatureOptimizer::loadDenseProblem() {
     // Configure OSQP solver
     std::size_t num_control_points = ref_spline_->size();
+    num_variables_ = num_control_points;
+    num_constraints_ = num_control_points;
     solver_->data()->setNumberOfVariables(num_control_points);
     solver_->data()->setNumberOfConstraints(num_control_points);
+    solver_->data()->setLinearConstraintsMatrix(toSparseMatrix(A_));
     solver_->data()->setHessianMatrix(toSparseMatrix(H_));
     solver_->data()->setGradient(c_);
-    solver_->data()->setLinearConstraintsMatrix(toSparseMatrix(A_));
     solver_->data()->setLowerBound(lower_bound_);
     solver_->data()->setUpperBound(upper_bound_);
 }
 
+const ReferenceSetup MinCurvatureOptimizer::setUpReference(const std::shared_ptr<BaseCubicSpline>& ref_spline) {
+    if (params_->formulation != QPFormulation::DenseSpline) {
+        throw std::invalid_argument("Shared reference setups need the dense formulation.");
+    }
+    ref_spline_ = ref_spline;
+    computeHessianAndLinear();
+    return {ref_spline_, normal_vectors_, H_, c_};
+}
+
+void MinCurvatureOptimizer::setUp(const ReferenceSetup& reference, const CandidateCorridor& corridor,
+                                  const double last_point_shrink) {
+    if (params_->formulation != QPFormulation::DenseSpline) {
+        throw std::invalid_argument("Shared reference setups need the dense formulation.");
+    }
+    assert(last_point_shrink >= 0.0 && last_point_shrink <= 1.0);
+    if (corridor.distance_field) {
+        setDistanceField(reference.ref_spline, corridor.distance_field);
+    } else if (corridor.left_spline && corridor.right_spline) {
+        setSplines(reference.ref_spline, corridor.left_spline, corridor.right_spline);
+    } else {
+        setCorridor(reference.ref_spline, corridor.widths);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    // Only the bounds depend on the corridor, the rest is copied from the reference
+    last_point_shrink_ = last_point_shrink;
+    normal_vectors_ = reference.normal_vectors;
+    H_ = reference.H;
+    c_ = reference.c;
+    if (lookUpCache(last_point_shrink)) {
+        setup_time_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return;
+    }
+    solver_->clearSolver();
+    solver_->data()->clearHessianMatrix();
+    solver_->data()->clearLinearConstraintsMatrix();
+    computeConstraints(last_point_shrink);
+    loadDenseProblem();
+    auto end = std::chrono::high_resolution_clock::now();
+    setup_time_ = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
 const Eigen::SparseMatrix<double> MinCurvatureOptimizer::toSparseMatrix(const Eigen::MatrixXd& matrix) const {
     Eigen::SparseMatrix<double> sparse_matrix(matrix.rows(), matrix.cols());
     for (int i = 0; i < matrix.outerSize(); ++i) {
@@ -290,20 +807,181 @@ const Eigen::MatrixXd MinCurvatureOptimizer::fromSparseMatrix(const Eigen::Spars
     return Eigen::MatrixXd(sparse_matrix);
 }
 
+const bool MinCurvatureOptimizer::solveUnconstrained() {
+    if (!params_->unconstrained_fast_path || params_->formulation != QPFormulation::DenseSpline) {
+        return false;
+    }
+    // Points whose bounds coincide, like the first one, are fixed and eliminated from the system
+    const Eigen::Index num_points = H_.rows();
+    Eigen::VectorXd offsets = Eigen::VectorXd::Zero(num_points);
+    std::vector<Eigen::Index> free_points;
+    for (Eigen::Index i = 0; i < num_points; ++i) {
+        if (upper_bound_(i) > lower_bound_(i)) {
+            free_points.push_back(i);
+        } else {
+            offsets(i) = lower_bound_(i);
+        }
+    }
+    const Eigen::Index num_free = free_points.size();
+    if (num_free == 0) {
+        ++fast_path_stats_.misses;
+        return false;
+    }
+    Eigen::MatrixXd hessian(num_free, num_free);
+    Eigen::VectorXd rhs(num_free);
+    const Eigen::VectorXd fixed_gradient = c_ + H_ * offsets;
+    for (Eigen::Index j = 0; j < num_free; ++j) {
+        rhs(j) = -fixed_gradient(free_points[j]);
+        for (Eigen::Index i = 0; i < num_free; ++i) {
+            hessian(i, j) = H_(free_points[i], free_points[j]);
+        }
+    }
+
+    // The two passes of the ROS wrapper set up the same problem twice
+    if (hessian.rows() == fast_path_hessian_.rows() && hessian == fast_path_hessian_) {
+        ++fast_path_stats_.factorization_reuses;
+    } else {
+        fast_path_hessian_ = hessian;
+        fast_path_factorization_.compute(fast_path_hessian_);
+    }
+    if (fast_path_factorization_.info() != Eigen::Success) {
+        ++fast_path_stats_.misses;
+        return false;
+    }
+
+    // H_ is only semidefinite: offsets that leave the curvature unchanged remain free after fixing the
+    // first point. With P'LDL'P = H, a zero pivot of D marks a null vector and the minimizers are a
+    // particular solution plus any multiple of it.
+    const Eigen::VectorXd& pivots = fast_path_factorization_.vectorD();
+    const double null_threshold = 1e-9 * std::max(1.0, pivots.cwiseAbs().maxCoeff());
+    Eigen::VectorXd free_offsets = fast_path_factorization_.transpositionsP() * rhs;
+    fast_path_factorization_.matrixL().solveInPlace(free_offsets);
+    std::vector<Eigen::Index> null_pivots;
+    for (Eigen::Index k = 0; k < num_free; ++k) {
+        if (pivots(k) > null_threshold) {
+            free_offsets(k) /= pivots(k);
+            continue;
+        }
+        // A gradient along the null space makes the objective unbounded, the bounds decide
+        if (pivots(k) < -null_threshold || std::abs(free_offsets(k)) > 1e-9 * std::max(1.0, rhs.norm())) {
+            ++fast_path_stats_.misses;
+            return false;
+        }
+        free_offsets(k) = 0.0;
+        null_pivots.push_back(k);
+    }
+    if (null_pivots.size() > 1) {
+        ++fast_path_stats_.misses;
+        return false;
+    }
+    fast_path_factorization_.matrixU().solveInPlace(free_offsets);
+    free_offsets = fast_path_factorization_.transpositionsP().transpose() * free_offsets;
+    Eigen::VectorXd null_vector = Eigen::VectorXd::Zero(num_free);
+    if (!null_pivots.empty()) {
+        null_vector(null_pivots.front()) = 1.0;
+        fast_path_factorization_.matrixU().solveInPlace(null_vector);
+        null_vector = fast_path_factorization_.transpositionsP().transpose() * null_vector;
+        null_vector.normalize();
+    }
+
+    // Range of null vector multiples that keeps every point inside its bounds, the one closest to
+    // the centerline is taken
+    double min_step = -std::numeric_limits<double>::infinity();
+    double max_step = std::numeric_limits<double>::infinity();
+    for (Eigen::Index j = 0; j < num_free; ++j) {
+        const Eigen::Index i = free_points[j];
+        const double direction = null_vector(j);
+        if (std::abs(direction) < 1e-12) {
+            if (free_offsets(j) < lower_bound_(i) || free_offsets(j) > upper_bound_(i)) {
+                min_step = std::numeric_limits<double>::infinity();
+                break;
+            }
+            continue;
+        }
+        const double step_a = (lower_bound_(i) - free_offsets(j)) / direction;
+        const double step_b = (upper_bound_(i) - free_offsets(j)) / direction;
+        min_step = std::max(min_step, std::min(step_a, step_b));
+        max_step = std::min(max_step, std::max(step_a, step_b));
+    }
+    if (min_step > max_step) {
+        ++fast_path_stats_.misses;
+        return false;
+    }
+    free_offsets += std::clamp(-free_offsets.dot(null_vector), min_step, max_step) * null_vector;
+    for (Eigen::Index j = 0; j < num_free; ++j) {
+        offsets(free_points[j]) = std::clamp(free_offsets(j), lower_bound_(free_points[j]), upper_bound_(free_points[j]));
+    }
+    if (!offsets.allFinite()) {
+        // Left to OSQP, which reports the failure
+        ++fast_path_stats_.misses;
+        return false;
+    }
+
+    // A feasible unconstrained minimizer solves the QP. Only the fixed points have non-zero
+    // multipliers, y = -(H x + c) as in OSQP, which keeps warm starts and checkpoints valid.
+    ++fast_path_stats_.hits;
+    solution_ = offsets;
+    last_primal_ = offsets;
+    last_dual_ = -(H_ * offsets + c_);
+    return true;
+}
+
 void MinCurvatureOptimizer::solve(std::shared_ptr<BaseCubicSpline>& opt_traj, const double normal_weight) {
-    // Solve the QP problem
-    auto start = std::chrono::high_resolution_clock::now();
-    solver_->initSolver();
-    solver_->solveProblem();
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    if (params_->verbose) {
-        std::cout << "Solving time: " << duration.count() << "us\n";
+    Eigen::VectorXd solution;
+    last_iterations_ = 0;
+    status_ = SolveStatus::Solved;
+    if (cache_hit_) {
+        // Reuse the stored offsets, what is saved is the original computation minus the lookup
+        solution_ = cached_solution_.solution;
+        solution = normal_weight * solution_;
+        cache_->addSavedTime(std::max(0.0, cached_solution_.compute_time - setup_time_));
+    } else {
+        auto start = std::chrono::high_resolution_clock::now();
+        bool solved = solveUnconstrained();
+        if (!solved) {
+            // Solve the QP problem
+            solver_->initSolver();
+            // Start from the previous solution, possibly restored from a checkpoint, while the problem size is unchanged
+            const bool previous_solution = params_->warm_start && params_->reuse_solution &&
+                static_cast<std::size_t>(last_primal_.size()) == num_variables_ &&
+                static_cast<std::size_t>(last_dual_.size()) == num_constraints_;
+            if (previous_solution) {
+                solver_->setWarmStart(last_primal_, last_dual_);
+            }
+            solver_->solveProblem();
+            last_iterations_ = static_cast<std::size_t>(solver_->workspace()->info->iter);
+            // Retrieve the solution (optimized control points), the lifted formulation stores the offsets first
+            solution_ = solver_->getSolution().head(ref_spline_->size());
+            const bool finite = solver_->getSolution().allFinite() && solver_->getDualSolution().allFinite();
+            solved = finite && solver_->getStatus() == OsqpEigen::Status::Solved;
+            if (!solved) {
+                status_ = finite && solver_->getStatus() == OsqpEigen::Status::MaxIterReached ?
+                    SolveStatus::MaxIterations : SolveStatus::Failed;
+            }
+            // An iterate stopped by the limit is still a useful warm start
+            if (finite) {
+                last_primal_ = solver_->getSolution();
+                last_dual_ = solver_->getDualSolution();
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        if (params_->verbose) {
+            std::cout << "Solving time: " << duration.count() << "us\n";
+        }
+        if (solved && !warm_up_ && !params_->checkpoint_file.empty() && ++solves_since_checkpoint_ >= params_->checkpoint_interval) {
+            saveCheckpoint();
+            solves_since_checkpoint_ = 0;
+        }
+        // Neither a failed solve nor the last iterate of one stopped by the limit is worth repeating
+        if (solved && cache_ && !cache_key_.empty()) {
+            const double compute_time = setup_time_ + std::chrono::duration<double, std::milli>(end - start).count();
+            cache_->insert(cache_key_, {solution_, normal_vectors_, compute_time});
+        }
+
+        solution = normal_weight * solution_;
     }
     
-    // Retrieve the solution (optimized control points)
-    Eigen::VectorXd solution = normal_weight * solver_->getSolution();
-    
     // Extract optimized control points (2D points for x and y)
     std::vector<Eigen::Vector2d> optimized_control_points(ref_spline_->size());
     const auto& control_points = ref_spline_->getControlPoints();
@@ -311,7 +989,14 @@ void MinCurvatureOptimizer::solve(std::shared_ptr<BaseCubicSpline>& opt_traj, co
         optimized_control_points[i].x() = control_points[i].x() + solution(i) * normal_vectors_(i, 0);
         optimized_control_points[i].y() = control_points[i].y() + solution(i) * normal_vectors_(i, 1);
     }
-    opt_traj->setControlPoints(optimized_control_points);
+    // Keep the knots of a non-uniform reference on the optimized trajectory
+    auto* parametric_traj = dynamic_cast<ParametricCubicSpline*>(opt_traj.get());
+    const auto* parametric_ref = dynamic_cast<const ParametricCubicSpline*>(ref_spline_.get());
+    if (parametric_traj != nullptr && parametric_ref != nullptr) {
+        parametric_traj->setControlPoints(optimized_control_points, parametric_ref->getKnots());
+    } else {
+        opt_traj->setControlPoints(optimized_control_points);
+    }
 }
  
 } // namespace optimization
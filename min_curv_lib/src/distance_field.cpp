@@ -0,0 +1,242 @@
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+#include "min_curv_lib/distance_field.hpp"
+
+namespace spline {
+namespace optimization {
+
+namespace {
+constexpr double kInfinity = 1e20;
+
+// Lower envelope of the parabolas (q - p)^2 + f(p), f holds squared distances and is overwritten
+void transform1D(std::vector<double>& f, const std::size_t n, std::vector<std::size_t>& v, std::vector<double>& z,
+                 std::vector<double>& d) {
+    std::size_t k = 0;
+    v[0] = 0;
+    z[0] = -kInfinity;
+    z[1] = kInfinity;
+    for (std::size_t q = 1; q < n; ++q) {
+        // Intersection with the rightmost parabola of the envelope, drop those the new one hides
+        const auto intersection = [&](const std::size_t p) {
+            return ((f[q] + static_cast<double>(q * q)) - (f[p] + static_cast<double>(p * p))) / (2.0 * (q - p));
+        };
+        double s = intersection(v[k]);
+        while (s <= z[k]) {
+            --k;
+            s = intersection(v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = kInfinity;
+    }
+    k = 0;
+    for (std::size_t q = 0; q < n; ++q) {
+        while (z[k + 1] < q) {
+            ++k;
+        }
+        const double offset = static_cast<double>(q) - static_cast<double>(v[k]);
+        d[q] = offset * offset + f[v[k]];
+    }
+    std::copy(d.begin(), d.begin() + n, f.begin());
+}
+
+// Squared distance of every cell to the nearest cell with target set, in cells
+const std::vector<double> squaredDistance(const std::vector<std::uint8_t>& occupied, const std::uint8_t target,
+                                          const std::size_t width, const std::size_t height) {
+    std::vector<double> squared(width * height);
+    for (std::size_t i = 0; i < squared.size(); ++i) {
+        squared[i] = occupied[i] == target ? 0.0 : kInfinity;
+    }
+    const std::size_t n = std::max(width, height);
+    std::vector<double> f(n), d(n), z(n + 1);
+    std::vector<std::size_t> v(n);
+    for (std::size_t x = 0; x < width; ++x) {
+        for (std::size_t y = 0; y < height; ++y) {
+            f[y] = squared[y * width + x];
+        }
+        transform1D(f, height, v, z, d);
+        for (std::size_t y = 0; y < height; ++y) {
+            squared[y * width + x] = f[y];
+        }
+    }
+    for (std::size_t y = 0; y < height; ++y) {
+        std::copy(squared.begin() + y * width, squared.begin() + (y + 1) * width, f.begin());
+        transform1D(f, width, v, z, d);
+        std::copy(f.begin(), f.begin() + width, squared.begin() + y * width);
+    }
+    return squared;
+}
+} // namespace
+
+DistanceField::DistanceField(const std::vector<std::int8_t>& occupancy,
+                             const std::size_t width,
+                             const std::size_t height,
+                             const double resolution,
+                             const Eigen::Vector2d& origin,
+                             const int occupied_threshold,
+                             const bool unknown_is_occupied)
+    : width_(width), height_(height), resolution_(resolution), origin_(origin) {
+    if (width == 0 || height == 0 || resolution <= 0.0 || occupancy.size() != width * height) {
+        throw std::invalid_argument("Occupancy grid must hold width x height cells and have a positive resolution.");
+    }
+    std::vector<std::uint8_t> occupied(occupancy.size());
+    for (std::size_t i = 0; i < occupancy.size(); ++i) {
+        occupied[i] = occupancy[i] < 0 ? unknown_is_occupied : occupancy[i] >= occupied_threshold;
+    }
+    transform(occupied);
+}
+
+const DistanceField DistanceField::fromBoundaries(const std::vector<Eigen::Vector2d>& left_boundary,
+                                                  const std::vector<Eigen::Vector2d>& right_boundary,
+                                                  const double resolution,
+                                                  const double margin) {
+    if (left_boundary.size() < 2 || right_boundary.size() < 2 || resolution <= 0.0) {
+        throw std::invalid_argument("Distance field needs two boundaries of at least two points and a positive resolution.");
+    }
+    // Corridor polygon, left boundary forward and right boundary backward, both extended at the ends
+    std::vector<Eigen::Vector2d> polygon;
+    const auto extend = [margin](const Eigen::Vector2d& end, const Eigen::Vector2d& previous) {
+        const Eigen::Vector2d direction = end - previous;
+        const double length = direction.norm();
+        return length > 0.0 ? Eigen::Vector2d(end + margin * direction / length) : end;
+    };
+    polygon.push_back(extend(left_boundary.front(), left_boundary[1]));
+    polygon.insert(polygon.end(), left_boundary.begin(), left_boundary.end());
+    polygon.push_back(extend(left_boundary.back(), left_boundary[left_boundary.size() - 2]));
+    polygon.push_back(extend(right_boundary.back(), right_boundary[right_boundary.size() - 2]));
+    polygon.insert(polygon.end(), right_boundary.rbegin(), right_boundary.rend());
+    polygon.push_back(extend(right_boundary.front(), right_boundary[1]));
+
+    Eigen::Vector2d lower = polygon.front();
+    Eigen::Vector2d upper = polygon.front();
+    for (const auto& point : polygon) {
+        lower = lower.cwiseMin(point);
+        upper = upper.cwiseMax(point);
+    }
+    const double padding = std::max(margin, resolution);
+    lower.array() -= padding;
+    upper.array() += padding;
+
+    DistanceField field;
+    field.resolution_ = resolution;
+    field.origin_ = lower;
+    field.width_ = static_cast<std::size_t>(std::ceil((upper.x() - lower.x()) / resolution));
+    field.height_ = static_cast<std::size_t>(std::ceil((upper.y() - lower.y()) / resolution));
+
+    // Even-odd scanline fill at the cell centers, every row crossing the polygon toggles at each edge
+    std::vector<std::uint8_t> occupied(field.width_ * field.height_, 1);
+    std::vector<double> crossings;
+    for (std::size_t y = 0; y < field.height_; ++y) {
+        const double center_y = lower.y() + (y + 0.5) * resolution;
+        crossings.clear();
+        for (std::size_t i = 0; i < polygon.size(); ++i) {
+            const Eigen::Vector2d& a = polygon[i];
+            const Eigen::Vector2d& b = polygon[(i + 1) % polygon.size()];
+            if ((a.y() <= center_y) != (b.y() <= center_y)) {
+                crossings.push_back(a.x() + (center_y - a.y()) / (b.y() - a.y()) * (b.x() - a.x()));
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+        for (std::size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            const double begin = std::ceil((crossings[i] - lower.x()) / resolution - 0.5);
+            const double end = std::floor((crossings[i + 1] - lower.x()) / resolution - 0.5);
+            for (double x = std::max(0.0, begin); x <= end && x < field.width_; ++x) {
+                occupied[y * field.width_ + static_cast<std::size_t>(x)] = 0;
+            }
+        }
+    }
+
+    // The boundaries themselves are walls, even where they pass between two cell centers
+    for (const auto* boundary : {&left_boundary, &right_boundary}) {
+        for (std::size_t i = 0; i + 1 < boundary->size(); ++i) {
+            const Eigen::Vector2d& a = (*boundary)[i];
+            const Eigen::Vector2d& b = (*boundary)[i + 1];
+            const std::size_t steps = static_cast<std::size_t>(std::ceil(2.0 * (b - a).norm() / resolution)) + 1;
+            for (std::size_t j = 0; j <= steps; ++j) {
+                const Eigen::Vector2d cell = (a + (b - a) * (static_cast<double>(j) / steps) - lower) / resolution;
+                occupied[static_cast<std::size_t>(cell.y()) * field.width_ + static_cast<std::size_t>(cell.x())] = 1;
+            }
+        }
+    }
+    field.transform(occupied);
+    return field;
+}
+
+void DistanceField::transform(const std::vector<std::uint8_t>& occupied) {
+    // Distances between cell centers, shifted by half a cell so that the zero level lies on the cell border
+    const std::vector<double> to_obstacle = squaredDistance(occupied, 1, width_, height_);
+    const std::vector<double> to_free = squaredDistance(occupied, 0, width_, height_);
+    const double max_distance = static_cast<double>(width_ + height_) * resolution_;
+    field_.resize(occupied.size());
+    for (std::size_t i = 0; i < occupied.size(); ++i) {
+        const double distance = occupied[i] ? -std::sqrt(to_free[i]) : std::sqrt(to_obstacle[i]);
+        const double shifted = (distance + (occupied[i] ? 0.5 : -0.5)) * resolution_;
+        field_[i] = static_cast<float>(std::max(-max_distance, std::min(max_distance, shifted)));
+    }
+}
+
+const double DistanceField::cell(const std::ptrdiff_t x, const std::ptrdiff_t y) const {
+    if (x < 0 || y < 0 || x >= static_cast<std::ptrdiff_t>(width_) || y >= static_cast<std::ptrdiff_t>(height_)) {
+        return -0.5 * resolution_;
+    }
+    return field_[y * width_ + x];
+}
+
+const double DistanceField::distance(const Eigen::Vector2d& point) const {
+    const Eigen::Vector2d grid = (point - origin_) / resolution_ - Eigen::Vector2d::Constant(0.5);
+    const double floor_x = std::floor(grid.x());
+    const double floor_y = std::floor(grid.y());
+    const double t_x = grid.x() - floor_x;
+    const double t_y = grid.y() - floor_y;
+    const auto x = static_cast<std::ptrdiff_t>(floor_x);
+    const auto y = static_cast<std::ptrdiff_t>(floor_y);
+    return (1 - t_y) * ((1 - t_x) * cell(x, y) + t_x * cell(x + 1, y)) +
+           t_y * ((1 - t_x) * cell(x, y + 1) + t_x * cell(x + 1, y + 1));
+}
+
+const double DistanceField::freeDistance(const Eigen::Vector2d& point, const Eigen::Vector2d& direction,
+                                         const double max_distance) const {
+    double travelled = 0.0;
+    double distance_here = distance(point);
+    if (distance_here <= 0.0) {
+        return 0.0;
+    }
+    while (travelled < max_distance) {
+        // Half a cell at least, the interpolated field can be flat near the zero level
+        const double step = std::max(distance_here, 0.5 * resolution_);
+        const double distance_next = distance(point + (travelled + step) * direction);
+        if (distance_next <= 0.0) {
+            // The zero crossing lies between the two samples, interpolate it linearly
+            return std::min(max_distance, travelled + step * distance_here / (distance_here - distance_next));
+        }
+        travelled += step;
+        distance_here = distance_next;
+    }
+    return max_distance;
+}
+
+const bool DistanceField::empty() const {
+    return field_.empty();
+}
+
+const std::size_t DistanceField::width() const {
+    return width_;
+}
+
+const std::size_t DistanceField::height() const {
+    return height_;
+}
+
+const double DistanceField::resolution() const {
+    return resolution_;
+}
+
+const Eigen::Vector2d& DistanceField::origin() const {
+    return origin_;
+}
+
+} // namespace optimization
+} // namespace spline
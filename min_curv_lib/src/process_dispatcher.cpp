@@ -0,0 +1,377 @@
+#include <deque>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#include "min_curv_lib/process_dispatcher.hpp"
+
+namespace spline {
+namespace optimization {
+
+namespace {
+// Frames never get close to this, a larger length means the stream is corrupt
+constexpr std::uint64_t kMaxFrameSize = std::uint64_t(1) << 30;
+
+const bool writeAll(const int socket, const char* data, std::size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL: a dead peer is an error code, not a SIGPIPE for the whole process
+        const ssize_t written = send(socket, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+const bool readAll(const int socket, char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t received = read(socket, data, size);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+const bool sendFrame(const int socket, const std::string& payload) {
+    const std::uint64_t size = payload.size();
+    return writeAll(socket, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+           writeAll(socket, payload.data(), payload.size());
+}
+
+const bool receiveFrame(const int socket, std::string& payload) {
+    std::uint64_t size = 0;
+    if (!readAll(socket, reinterpret_cast<char*>(&size), sizeof(size)) || size > kMaxFrameSize) {
+        return false;
+    }
+    payload.resize(size);
+    return readAll(socket, &payload[0], payload.size());
+}
+
+// Native byte order, both ends are the same binary
+class FrameWriter {
+public:
+    template <typename T>
+    void put(const T& value) {
+        data_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void putString(const std::string& value) {
+        put<std::uint64_t>(value.size());
+        data_.append(value);
+    }
+    void putPoints(const std::vector<Eigen::Vector2d>& points) {
+        put<std::uint64_t>(points.size());
+        for (const auto& point : points) {
+            put(point.x());
+            put(point.y());
+        }
+    }
+    const std::string& data() const {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+class FrameReader {
+public:
+    FrameReader(const std::string& data) : data_(data) {}
+
+    template <typename T>
+    const T get() {
+        T value;
+        take(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+    const std::string getString() {
+        std::string value(get<std::uint64_t>(), '\0');
+        take(&value[0], value.size());
+        return value;
+    }
+    const std::vector<Eigen::Vector2d> getPoints() {
+        const auto size = get<std::uint64_t>();
+        if (size > (data_.size() - offset_) / (2 * sizeof(double))) {
+            throw std::runtime_error("Truncated frame.");
+        }
+        std::vector<Eigen::Vector2d> points(size);
+        for (auto& point : points) {
+            point.x() = get<double>();
+            point.y() = get<double>();
+        }
+        return points;
+    }
+
+private:
+    void take(char* destination, const std::size_t size) {
+        if (size > data_.size() - offset_) {
+            throw std::runtime_error("Truncated frame.");
+        }
+        std::memcpy(destination, data_.data() + offset_, size);
+        offset_ += size;
+    }
+
+    const std::string& data_;
+    std::size_t offset_ = 0;
+};
+
+const std::string encodeRequest(const CorridorRequest& request) {
+    FrameWriter frame;
+    frame.put(request.weight);
+    frame.put(request.last_point_shrink);
+    frame.putPoints(request.centerline);
+    frame.putPoints(request.left_boundary);
+    frame.putPoints(request.right_boundary);
+    return frame.data();
+}
+
+const CorridorRequest decodeRequest(const std::string& data) {
+    FrameReader frame(data);
+    CorridorRequest request;
+    request.weight = frame.get<double>();
+    request.last_point_shrink = frame.get<double>();
+    request.centerline = frame.getPoints();
+    request.left_boundary = frame.getPoints();
+    request.right_boundary = frame.getPoints();
+    return request;
+}
+
+const std::string encodeResult(const CorridorResult& result) {
+    FrameWriter frame;
+    frame.put<std::uint8_t>(result.success);
+    frame.putString(result.message);
+    frame.putPoints(result.control_points);
+    frame.put(result.setup_time);
+    frame.put(result.solve_time);
+    return frame.data();
+}
+
+const CorridorResult decodeResult(const std::string& data) {
+    FrameReader frame(data);
+    CorridorResult result;
+    result.success = frame.get<std::uint8_t>() != 0;
+    result.message = frame.getString();
+    result.control_points = frame.getPoints();
+    result.setup_time = frame.get<double>();
+    result.solve_time = frame.get<double>();
+    return result;
+}
+} // namespace
+
+ProcessDispatcher::ProcessDispatcher() : ProcessDispatcher(std::make_unique<ProcessDispatcherParams>()) {}
+
+ProcessDispatcher::ProcessDispatcher(std::unique_ptr<ProcessDispatcherParams> params) : params_(std::move(params)) {
+    params_->num_workers = std::max<std::size_t>(1, params_->num_workers);
+    // Workers share the parameters but must not all write the same checkpoint
+    params_->optimizer.checkpoint_file.clear();
+    workers_.resize(params_->num_workers);
+    try {
+        for (auto& worker : workers_) {
+            startWorker(worker);
+        }
+    } catch (...) {
+        for (auto& worker : workers_) {
+            stopWorker(worker);
+        }
+        throw;
+    }
+}
+
+ProcessDispatcher::~ProcessDispatcher() {
+    for (auto& worker : workers_) {
+        stopWorker(worker);
+    }
+}
+
+void ProcessDispatcher::startWorker(Worker& worker) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        throw std::runtime_error(std::string("Could not create worker socket pair: ") + std::strerror(errno));
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(sockets[0]);
+        close(sockets[1]);
+        throw std::runtime_error(std::string("Could not fork worker: ") + std::strerror(errno));
+    }
+    if (pid == 0) {
+        // The other workers only see end of file once every copy of their socket is closed
+        for (const auto& other : workers_) {
+            if (other.socket >= 0) {
+                close(other.socket);
+            }
+        }
+        close(sockets[0]);
+        // Nothing may unwind into the parent's code, and none of its destructors or atexit handlers run
+        try {
+            workerLoop(sockets[1], params_->optimizer);
+        } catch (...) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(sockets[1]);
+    worker.pid = pid;
+    worker.socket = sockets[0];
+    worker.job = kIdle;
+}
+
+void ProcessDispatcher::stopWorker(Worker& worker) {
+    if (worker.pid > 0) {
+        // An idle worker exits on end of file, a busy or stuck one would only notice after its solve
+        if (worker.job != kIdle) {
+            kill(worker.pid, SIGKILL);
+        }
+    }
+    if (worker.socket >= 0) {
+        close(worker.socket);
+        worker.socket = -1;
+    }
+    if (worker.pid > 0) {
+        while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+        worker.pid = -1;
+    }
+    worker.job = kIdle;
+}
+
+void ProcessDispatcher::workerLoop(const int socket, const MinCurvatureParams& optimizer_params) {
+    // Same two pass scheme and error handling as the in-process batches, on one thread
+    BatchOptimizer optimizer(std::make_unique<BatchOptimizerParams>(1, 1, 0.0, optimizer_params));
+    std::string frame;
+    while (receiveFrame(socket, frame)) {
+        CorridorResult result;
+        try {
+            result = optimizer.solveBatch({decodeRequest(frame)}).front();
+        } catch (const std::exception& e) {
+            result.message = e.what();
+        }
+        if (!sendFrame(socket, encodeResult(result))) {
+            break;
+        }
+    }
+    close(socket);
+}
+
+std::vector<CorridorResult> ProcessDispatcher::solve(const std::vector<CorridorRequest>& requests) {
+    std::vector<CorridorResult> results(requests.size());
+    std::vector<std::size_t> attempts(requests.size(), 0);
+    std::deque<std::size_t> pending;
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        pending.push_back(i);
+    }
+    std::size_t remaining = requests.size();
+    const auto start = std::chrono::steady_clock::now();
+    const auto timeout = std::chrono::duration<double, std::milli>(params_->timeout);
+
+    // Replace the worker, its request is retried first or given up on
+    auto fail = [&](Worker& worker, const std::string& reason) {
+        const std::size_t index = worker.job;
+        stopWorker(worker);
+        ++restarts_;
+        startWorker(worker);
+        if (attempts[index] > params_->max_retries) {
+            results[index].message = reason + " after " + std::to_string(attempts[index]) + " attempts.";
+            --remaining;
+        } else {
+            pending.push_front(index);
+        }
+    };
+
+    std::vector<pollfd> poll_fds;
+    std::vector<Worker*> polled;
+    while (remaining > 0) {
+        for (auto& worker : workers_) {
+            if (worker.job != kIdle || pending.empty()) {
+                continue;
+            }
+            const std::size_t index = pending.front();
+            pending.pop_front();
+            ++attempts[index];
+            worker.job = index;
+            worker.started = std::chrono::steady_clock::now();
+            results[index].queue_time = std::chrono::duration<double, std::milli>(worker.started - start).count();
+            if (!sendFrame(worker.socket, encodeRequest(requests[index]))) {
+                fail(worker, "Worker exited before the request was sent");
+            }
+        }
+
+        // Wait for a result, or until the oldest attempt times out
+        poll_fds.clear();
+        polled.clear();
+        int wait = -1;
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& worker : workers_) {
+            if (worker.job == kIdle) {
+                continue;
+            }
+            poll_fds.push_back({worker.socket, POLLIN, 0});
+            polled.push_back(&worker);
+            if (params_->timeout > 0.0) {
+                const auto left = std::chrono::duration<double, std::milli>(worker.started + timeout - now).count();
+                const int left_ms = static_cast<int>(std::max(0.0, std::ceil(left)));
+                wait = wait < 0 ? left_ms : std::min(wait, left_ms);
+            }
+        }
+        if (poll_fds.empty()) {
+            continue;
+        }
+        if (poll(poll_fds.data(), poll_fds.size(), wait) < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("Polling the workers failed: ") + std::strerror(errno));
+        }
+
+        for (std::size_t i = 0; i < poll_fds.size(); ++i) {
+            Worker& worker = *polled[i];
+            if (poll_fds[i].revents != 0) {
+                // The result follows right after the worker starts writing, or end of file if it died
+                std::string frame;
+                CorridorResult result;
+                bool received = receiveFrame(worker.socket, frame);
+                if (received) {
+                    try {
+                        result = decodeResult(frame);
+                    } catch (const std::exception&) {
+                        received = false;
+                    }
+                }
+                if (!received) {
+                    fail(worker, "Worker exited while solving the request");
+                    continue;
+                }
+                result.queue_time = results[worker.job].queue_time;
+                result.batch_size = requests.size();
+                results[worker.job] = std::move(result);
+                worker.job = kIdle;
+                --remaining;
+            } else if (params_->timeout > 0.0 && std::chrono::steady_clock::now() - worker.started >= timeout) {
+                fail(worker, "Worker timed out");
+            }
+        }
+    }
+    return results;
+}
+
+const std::size_t ProcessDispatcher::getRestarts() const {
+    return restarts_;
+}
+
+} // namespace optimization
+} // namespace spline
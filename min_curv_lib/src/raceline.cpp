@@ -0,0 +1,218 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "min_curv_lib/raceline.hpp"
+#include "min_curv_lib/track_map.hpp"
+
+namespace spline {
+namespace optimization {
+
+namespace {
+// Read-only stream over a block of memory, used to deserialize the k-d tree from a mapped file
+struct MemoryBuffer : std::streambuf {
+    MemoryBuffer(const char* data, const std::size_t size) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+} // namespace
+
+Raceline::Raceline() {
+    params_ = std::make_unique<RacelineParams>();
+}
+
+Raceline::Raceline(std::unique_ptr<RacelineParams> params) : params_(std::move(params)) {}
+
+void Raceline::load(const std::string& file_name) {
+    std::ifstream file(file_name);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open raceline file " + file_name);
+    }
+
+    std::vector<Eigen::Vector2d> points;
+    std::vector<double> curvature;
+    std::vector<Eigen::Vector2d> centerline;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream row(line);
+        double x, y, kappa, center_x, center_y;
+        if (!(row >> x >> y >> kappa >> center_x >> center_y)) {
+            throw std::runtime_error("Malformed raceline row: " + line);
+        }
+        points.emplace_back(x, y);
+        curvature.push_back(kappa);
+        centerline.emplace_back(center_x, center_y);
+    }
+    setRaceline(points, curvature, centerline);
+}
+
+void Raceline::save(const std::string& file_name,
+                    const std::vector<Eigen::Vector2d>& points,
+                    const std::vector<double>& curvature,
+                    const std::vector<Eigen::Vector2d>& centerline) {
+    if (points.size() != curvature.size() || points.size() != centerline.size()) {
+        throw std::invalid_argument("Raceline points, curvature and centerline must have the same size.");
+    }
+    std::ofstream file(file_name);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open raceline file " + file_name);
+    }
+    file << "# x y curvature center_x center_y\n" << std::setprecision(17);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        file << points[i].x() << " " << points[i].y() << " " << curvature[i] << " "
+             << centerline[i].x() << " " << centerline[i].y() << "\n";
+    }
+}
+
+void Raceline::setRaceline(const std::vector<Eigen::Vector2d>& points,
+                           const std::vector<double>& curvature,
+                           const std::vector<Eigen::Vector2d>& centerline) {
+    if (points.size() != curvature.size() || points.size() != centerline.size()) {
+        throw std::invalid_argument("Raceline points, curvature and centerline must have the same size.");
+    }
+    if (points.size() < params_->min_window_size) {
+        throw std::invalid_argument("Raceline has fewer samples than the minimum window size.");
+    }
+    points_ = points;
+    curvature_ = curvature;
+    centerline_ = centerline;
+    buildIndex();
+}
+
+void Raceline::setRaceline(const TrackMap& track_map) {
+    params_->closed = track_map.closed();
+    params_->kdtree_leafs = track_map.kdtreeLeafs();
+    points_ = track_map.getPoints();
+    curvature_ = track_map.getCurvature();
+    centerline_ = track_map.getCenterline();
+    if (points_.size() < params_->min_window_size) {
+        throw std::invalid_argument("Raceline has fewer samples than the minimum window size.");
+    }
+
+    std::size_t index_size;
+    const char* index = track_map.getIndex(index_size);
+    MemoryBuffer buffer(index, index_size);
+    std::istream stream(&buffer);
+    centerline_tree_.reset();
+    centerline_cloud_ = std::make_unique<KDTreeAdapter>(centerline_);
+    centerline_tree_ = std::make_unique<KDTree>(2, *centerline_cloud_,
+                                                nanoflann::KDTreeSingleIndexAdaptorParams(params_->kdtree_leafs,
+                                                                                          nanoflann::KDTreeSingleIndexAdaptorFlags::SkipInitialBuildIndex));
+    centerline_tree_->loadIndex(stream);
+    if (!stream) {
+        centerline_tree_.reset();
+        throw std::runtime_error("Truncated k-d tree in track map.");
+    }
+}
+
+void Raceline::saveIndex(std::ostream& stream) const {
+    if (!centerline_tree_) {
+        throw std::logic_error("Raceline has not been loaded.");
+    }
+    centerline_tree_->saveIndex(stream);
+}
+
+void Raceline::buildIndex() {
+    centerline_tree_.reset();
+    centerline_cloud_ = std::make_unique<KDTreeAdapter>(centerline_);
+    centerline_tree_ = std::make_unique<KDTree>(2, *centerline_cloud_,
+                                                nanoflann::KDTreeSingleIndexAdaptorParams(params_->kdtree_leafs,
+                                                                                          nanoflann::KDTreeSingleIndexAdaptorFlags::SkipInitialBuildIndex));
+    centerline_tree_->buildIndex();
+}
+
+const std::size_t Raceline::findNearestIndex(const Eigen::Vector2d& point, double& distance) const {
+    if (!centerline_tree_) {
+        throw std::logic_error("Raceline has not been loaded.");
+    }
+    const double query_point[2] = { point.x(), point.y() };
+    unsigned int nearest_index;
+    double nearest_distance_sq;
+    centerline_tree_->knnSearch(&query_point[0], 1, &nearest_index, &nearest_distance_sq);
+    distance = std::sqrt(nearest_distance_sq);
+    return nearest_index;
+}
+
+const bool Raceline::getWindow(const std::vector<Eigen::Vector2d>& perceived_centerline, RacelineWindow& window) const {
+    window.deviation = 0.0;
+    window.rejection.clear();
+    if (!centerline_tree_) {
+        window.rejection = "No raceline loaded";
+        return false;
+    }
+    if (perceived_centerline.size() < 2) {
+        window.rejection = "Corridor has fewer than two centerline points";
+        return false;
+    }
+
+    // The perceived corridor has to lie on the map, otherwise the stored raceline is not valid
+    for (const auto& point : perceived_centerline) {
+        double distance;
+        findNearestIndex(point, distance);
+        window.deviation = std::max(window.deviation, distance);
+        if (window.deviation > params_->max_deviation) {
+            std::ostringstream rejection;
+            rejection << "Corridor deviates " << std::fixed << std::setprecision(2) << window.deviation
+                      << " m from the raceline map";
+            window.rejection = rejection.str();
+            return false;
+        }
+    }
+
+    double distance;
+    const std::size_t start_index = findNearestIndex(perceived_centerline.front(), distance);
+    const std::size_t end_index = findNearestIndex(perceived_centerline.back(), distance);
+    const std::size_t num_samples = points_.size();
+    std::size_t window_size;
+    if (end_index >= start_index) {
+        window_size = end_index - start_index + 1;
+    } else if (params_->closed) {
+        window_size = num_samples - start_index + end_index + 1;
+    } else {
+        window.rejection = "Corridor runs backwards on an open raceline";
+        return false;
+    }
+    if (window_size < params_->min_window_size) {
+        window.rejection = "Raceline window has only " + std::to_string(window_size) + " samples";
+        return false;
+    }
+
+    window.start_index = start_index;
+    window.points.resize(window_size);
+    window.curvature.resize(window_size);
+    for (std::size_t i = 0; i < window_size; ++i) {
+        const std::size_t index = (start_index + i) % num_samples;
+        window.points[i] = points_[index];
+        window.curvature[i] = curvature_[index];
+    }
+    return true;
+}
+
+const std::size_t Raceline::size() const {
+    return points_.size();
+}
+
+const std::vector<Eigen::Vector2d>& Raceline::getPoints() const {
+    return points_;
+}
+
+const std::vector<double>& Raceline::getCurvature() const {
+    return curvature_;
+}
+
+const std::vector<Eigen::Vector2d>& Raceline::getCenterline() const {
+    return centerline_;
+}
+
+const RacelineParams& Raceline::getParams() const {
+    return *params_;
+}
+
+} // namespace optimization
+} // namespace spline
@@ -0,0 +1,102 @@
+#include <cmath>
+
+#include "min_curv_lib/solution_cache.hpp"
+
+namespace spline {
+namespace optimization {
+
+const double CacheStats::hitRate() const {
+    const std::size_t lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+}
+
+SolutionCache::SolutionCache(const std::size_t capacity, const double quantization)
+    : capacity_(capacity), quantization_(quantization) {}
+
+const std::int64_t SolutionCache::quantize(const double value) const {
+    return static_cast<std::int64_t>(std::llround(value / quantization_));
+}
+
+const SolutionCache::Key SolutionCache::makeKey(const std::vector<Eigen::Vector2d>& ref_points,
+                                                const std::vector<Eigen::Vector2d>& left_points,
+                                                const std::vector<Eigen::Vector2d>& right_points,
+                                                const std::vector<double>& params) const {
+    Key key;
+    key.reserve(3 + 2 * (ref_points.size() + left_points.size() + right_points.size()) + params.size());
+    // Sizes are part of the key so that differently split inputs never collide
+    key.push_back(ref_points.size());
+    key.push_back(left_points.size());
+    key.push_back(right_points.size());
+    for (const auto* points : {&ref_points, &left_points, &right_points}) {
+        for (const auto& point : *points) {
+            key.push_back(quantize(point.x()));
+            key.push_back(quantize(point.y()));
+        }
+    }
+    // Parameters are stored at a fixed fine resolution, they are not noisy inputs
+    for (const double param : params) {
+        key.push_back(static_cast<std::int64_t>(std::llround(param * 1e6)));
+    }
+    return key;
+}
+
+std::size_t SolutionCache::KeyHash::operator()(const Key& key) const {
+    // FNV-1a over the quantized values
+    std::uint64_t hash = 1469598103934665603ULL;
+    for (const auto value : key) {
+        hash ^= static_cast<std::uint64_t>(value);
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+const CachedSolution* SolutionCache::find(const Key& key) {
+    const auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    // Move the entry to the front of the LRU list
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+}
+
+void SolutionCache::insert(const Key& key, const CachedSolution& solution) {
+    if (capacity_ == 0) {
+        return;
+    }
+    const auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->second = solution;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    if (entries_.size() >= capacity_) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+    entries_.emplace_front(key, solution);
+    index_[key] = entries_.begin();
+}
+
+void SolutionCache::addSavedTime(const double saved_time) {
+    stats_.saved_time += saved_time;
+}
+
+void SolutionCache::clear() {
+    entries_.clear();
+    index_.clear();
+    stats_ = CacheStats();
+}
+
+const CacheStats& SolutionCache::getStats() const {
+    return stats_;
+}
+
+const std::size_t SolutionCache::size() const {
+    return entries_.size();
+}
+
+} // namespace optimization
+} // namespace spline
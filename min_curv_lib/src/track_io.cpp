@@ -0,0 +1,43 @@
+#include <fstream>
+#include <stdexcept>
+
+#include "min_curv_lib/track_io.hpp"
+
+namespace spline {
+
+const std::vector<Eigen::Vector2d> loadPoints(const std::string& file_name) {
+    std::ifstream file(file_name);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open " + file_name);
+    }
+    std::vector<Eigen::Vector2d> points;
+    double x, y;
+    while (file >> x >> y) {
+        points.emplace_back(x, y);
+    }
+    return points;
+}
+
+const std::vector<Eigen::Vector2d> resamplePolyline(const std::vector<Eigen::Vector2d>& points, const std::size_t num_points) {
+    if (points.size() < 2 || num_points < 2) {
+        throw std::invalid_argument("Resampling needs at least two input and two output points.");
+    }
+    std::vector<double> arc_length(points.size(), 0.0);
+    for (std::size_t i = 1; i < points.size(); ++i) {
+        arc_length[i] = arc_length[i - 1] + (points[i] - points[i - 1]).norm();
+    }
+    std::vector<Eigen::Vector2d> resampled(num_points);
+    std::size_t j = 0;
+    for (std::size_t k = 0; k < num_points; ++k) {
+        const double s = arc_length.back() * k / (num_points - 1);
+        while (j + 2 < points.size() && arc_length[j + 1] < s) {
+            ++j;
+        }
+        const double segment = arc_length[j + 1] - arc_length[j];
+        const double t = segment > 0.0 ? (s - arc_length[j]) / segment : 0.0;
+        resampled[k] = points[j] + t * (points[j + 1] - points[j]);
+    }
+    return resampled;
+}
+
+} // namespace spline
@@ -0,0 +1,227 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "min_curv_lib/track_map.hpp"
+
+namespace spline {
+namespace optimization {
+
+namespace {
+constexpr char kMagic[8] = {'M', 'C', 'T', 'R', 'A', 'C', 'K', '\0'};
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::size_t kNumSampleColumns = 5;
+
+const std::size_t align(const std::size_t offset) {
+    return (offset + 7) & ~static_cast<std::size_t>(7);
+}
+
+void writeDoubles(std::ofstream& file, const double* values, const std::size_t size) {
+    file.write(reinterpret_cast<const char*>(values), size * sizeof(double));
+}
+
+void writePadding(std::ofstream& file, const std::size_t size) {
+    static const char zeros[8] = {};
+    file.write(zeros, align(size) - size);
+}
+} // namespace
+
+TrackMap::TrackMap(const std::string& file_name) {
+    open(file_name);
+}
+
+TrackMap::~TrackMap() {
+    close();
+}
+
+void TrackMap::save(const std::string& file_name,
+                    const Raceline& raceline,
+                    const std::map<std::size_t, Eigen::MatrixXd>& system_inverses) {
+    std::ostringstream index_stream;
+    raceline.saveIndex(index_stream);
+    const std::string index = index_stream.str();
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.num_samples = raceline.size();
+    header.kdtree_leafs = raceline.getParams().kdtree_leafs;
+    header.index_size = index.size();
+    header.num_operators = system_inverses.size();
+    header.closed = raceline.getParams().closed ? 1 : 0;
+
+    std::ofstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open track map file " + file_name);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Samples, one array per column so that they can be mapped without conversion
+    Eigen::MatrixXd samples(raceline.size(), kNumSampleColumns);
+    for (std::size_t i = 0; i < raceline.size(); ++i) {
+        samples.row(i) << raceline.getPoints()[i].x(), raceline.getPoints()[i].y(), raceline.getCurvature()[i],
+                          raceline.getCenterline()[i].x(), raceline.getCenterline()[i].y();
+    }
+    writeDoubles(file, samples.data(), samples.size());
+
+    file.write(index.data(), index.size());
+    writePadding(file, index.size());
+
+    for (const auto& system_inverse : system_inverses) {
+        const std::uint64_t num_control_points = system_inverse.first;
+        if (system_inverse.second.rows() != static_cast<Eigen::Index>(4 * num_control_points) ||
+            system_inverse.second.cols() != static_cast<Eigen::Index>(4 * num_control_points)) {
+            throw std::invalid_argument("System matrix inverse must be 4N x 4N.");
+        }
+        file.write(reinterpret_cast<const char*>(&num_control_points), sizeof(num_control_points));
+        writeDoubles(file, system_inverse.second.data(), system_inverse.second.size());
+    }
+    if (!file) {
+        throw std::runtime_error("Could not write track map file " + file_name);
+    }
+}
+
+void TrackMap::open(const std::string& file_name) {
+    close();
+    file_descriptor_ = ::open(file_name.c_str(), O_RDONLY);
+    if (file_descriptor_ < 0) {
+        throw std::runtime_error("Could not open track map file " + file_name);
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor_, &file_stat) != 0 || static_cast<std::size_t>(file_stat.st_size) < sizeof(Header)) {
+        close();
+        throw std::runtime_error("Track map file " + file_name + " is too small.");
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_descriptor_, 0);
+    if (mapping == MAP_FAILED) {
+        size_ = 0;
+        close();
+        throw std::runtime_error("Could not map track map file " + file_name);
+    }
+    data_ = static_cast<const char*>(mapping);
+    header_ = reinterpret_cast<const Header*>(data_);
+
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 || header_->byte_order != kByteOrder) {
+        close();
+        throw std::runtime_error(file_name + " is not a track map of this platform.");
+    }
+    if (header_->version != kVersion) {
+        const std::uint32_t version = header_->version;
+        close();
+        throw std::runtime_error("Track map " + file_name + " has version " + std::to_string(version) +
+                                 ", expected " + std::to_string(kVersion) + ".");
+    }
+
+    // Walk the sections, checking that each one lies inside the file
+    std::size_t offset = sizeof(Header);
+    auto remaining = [&]() -> std::size_t {
+        return offset > size_ ? 0 : size_ - offset;
+    };
+    auto truncated = [&]() {
+        close();
+        throw std::runtime_error("Track map file " + file_name + " is truncated.");
+    };
+    auto take = [&](const std::size_t bytes) {
+        if (bytes > remaining()) {
+            truncated();
+        }
+        const char* section = data_ + offset;
+        offset = align(offset + bytes);
+        return section;
+    };
+    // Counts come from the file, so they are bounded by dividing the remaining size before multiplying
+    auto take_array = [&](const std::size_t count, const std::size_t element_size) {
+        if (element_size != 0 && count > remaining() / element_size) {
+            truncated();
+        }
+        return take(count * element_size);
+    };
+    samples_ = reinterpret_cast<const double*>(take_array(header_->num_samples, kNumSampleColumns * sizeof(double)));
+    index_ = take(header_->index_size);
+    const std::size_t num_operators = header_->num_operators;
+    for (std::size_t i = 0; i < num_operators; ++i) {
+        const std::uint64_t num_control_points = *reinterpret_cast<const std::uint64_t*>(take(sizeof(std::uint64_t)));
+        // 4N x 4N doubles, N alone is bounded first so that the size of a row cannot overflow
+        if (num_control_points > remaining() / (16 * sizeof(double))) {
+            truncated();
+        }
+        system_inverses_[num_control_points] = reinterpret_cast<const double*>(
+            take_array(num_control_points, 16 * num_control_points * sizeof(double)));
+    }
+}
+
+void TrackMap::close() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    if (file_descriptor_ >= 0) {
+        ::close(file_descriptor_);
+    }
+    file_descriptor_ = -1;
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    samples_ = nullptr;
+    index_ = nullptr;
+    system_inverses_.clear();
+}
+
+const bool TrackMap::isOpen() const {
+    return data_ != nullptr;
+}
+
+const bool TrackMap::closed() const {
+    return header_->closed != 0;
+}
+
+const std::size_t TrackMap::numSamples() const {
+    return header_->num_samples;
+}
+
+const std::size_t TrackMap::kdtreeLeafs() const {
+    return header_->kdtree_leafs;
+}
+
+const std::vector<Eigen::Vector2d> TrackMap::getPoints() const {
+    const std::size_t num_samples = numSamples();
+    std::vector<Eigen::Vector2d> points(num_samples);
+    for (std::size_t i = 0; i < num_samples; ++i) {
+        points[i] = Eigen::Vector2d(samples_[i], samples_[num_samples + i]);
+    }
+    return points;
+}
+
+const std::vector<double> TrackMap::getCurvature() const {
+    const double* curvature = samples_ + 2 * numSamples();
+    return std::vector<double>(curvature, curvature + numSamples());
+}
+
+const std::vector<Eigen::Vector2d> TrackMap::getCenterline() const {
+    const std::size_t num_samples = numSamples();
+    std::vector<Eigen::Vector2d> centerline(num_samples);
+    for (std::size_t i = 0; i < num_samples; ++i) {
+        centerline[i] = Eigen::Vector2d(samples_[3 * num_samples + i], samples_[4 * num_samples + i]);
+    }
+    return centerline;
+}
+
+const char* TrackMap::getIndex(std::size_t& size) const {
+    size = header_->index_size;
+    return index_;
+}
+
+const double* TrackMap::getSystemInverse(const std::size_t num_control_points) const {
+    const auto it = system_inverses_.find(num_control_points);
+    return it == system_inverses_.end() ? nullptr : it->second;
+}
+
+} // namespace optimization
+} // namespace spline
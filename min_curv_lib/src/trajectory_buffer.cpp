@@ -0,0 +1,165 @@
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <algorithm>
+
+#include "min_curv_lib/trajectory_buffer.hpp"
+
+namespace spline {
+
+TrajectorySnapshot::TrajectorySnapshot(const std::size_t num_samples)
+    : samples_(std::max<std::size_t>(num_samples, 2)) {}
+
+void TrajectorySnapshot::assign(const BaseCubicSpline& trajectory, const std::uint64_t sequence, const double stamp) {
+    const std::size_t num_samples = samples_.size();
+    // u = 1 is left out, the B-spline basis is only defined on [0, 1)
+    const double u_max = std::nextafter(1.0, 0.0);
+    for (std::size_t i = 0; i < num_samples; ++i) {
+        const double u = std::min(u_max, static_cast<double>(i) / (num_samples - 1));
+        auto& sample = samples_[i];
+        sample.position = trajectory.evaluateSpline(u, 0);
+        const Eigen::Vector2d first = trajectory.evaluateSpline(u, 1);
+        const Eigen::Vector2d second = trajectory.evaluateSpline(u, 2);
+        const double speed = first.norm();
+        sample.heading = std::atan2(first.y(), first.x());
+        sample.curvature = speed > 0.0 ? (first.x() * second.y() - first.y() * second.x()) / (speed * speed * speed) : 0.0;
+        sample.s = i == 0 ? 0.0 : samples_[i - 1].s + (sample.position - samples_[i - 1].position).norm();
+    }
+    sequence_ = sequence;
+    stamp_ = stamp;
+}
+
+const TrajectorySample TrajectorySnapshot::sample(const double s) const {
+    if (s <= samples_.front().s) {
+        return samples_.front();
+    }
+    if (s >= samples_.back().s) {
+        return samples_.back();
+    }
+    const auto upper = std::upper_bound(samples_.begin(), samples_.end(), s,
+                                        [](const double value, const TrajectorySample& sample) { return value < sample.s; });
+    const auto& next = *upper;
+    const auto& previous = *(upper - 1);
+    const double length = next.s - previous.s;
+    const double t = length > 0.0 ? (s - previous.s) / length : 0.0;
+
+    TrajectorySample result;
+    result.s = s;
+    result.position = previous.position + t * (next.position - previous.position);
+    result.curvature = previous.curvature + t * (next.curvature - previous.curvature);
+    // Interpolate the heading along the shorter arc
+    const double heading_change = std::remainder(next.heading - previous.heading, 2.0 * M_PI);
+    result.heading = std::remainder(previous.heading + t * heading_change, 2.0 * M_PI);
+    return result;
+}
+
+const TrajectorySample TrajectorySnapshot::closestPoint(const Eigen::Vector2d& point, double& distance) const {
+    double best_distance_sq = std::numeric_limits<double>::max();
+    double best_s = 0.0;
+    for (std::size_t i = 0; i + 1 < samples_.size(); ++i) {
+        const Eigen::Vector2d segment = samples_[i + 1].position - samples_[i].position;
+        const double length_sq = segment.squaredNorm();
+        const double t = length_sq > 0.0 ? std::clamp((point - samples_[i].position).dot(segment) / length_sq, 0.0, 1.0) : 0.0;
+        const double distance_sq = (samples_[i].position + t * segment - point).squaredNorm();
+        if (distance_sq < best_distance_sq) {
+            best_distance_sq = distance_sq;
+            best_s = samples_[i].s + t * (samples_[i + 1].s - samples_[i].s);
+        }
+    }
+    distance = std::sqrt(best_distance_sq);
+    return sample(best_s);
+}
+
+const double TrajectorySnapshot::length() const {
+    return samples_.empty() ? 0.0 : samples_.back().s;
+}
+
+const std::uint64_t TrajectorySnapshot::sequence() const {
+    return sequence_;
+}
+
+const double TrajectorySnapshot::stamp() const {
+    return stamp_;
+}
+
+TrajectoryBuffer::ReadGuard::ReadGuard(const TrajectoryBuffer& buffer) : buffer_(buffer) {
+    // Pin the current slot, then make sure it is still current: the writer may have started
+    // refilling it before the pin became visible
+    while (true) {
+        slot_ = buffer_.current_.load();
+        buffer_.readers_[slot_].fetch_add(1);
+        if (buffer_.current_.load() == slot_) {
+            break;
+        }
+        buffer_.readers_[slot_].fetch_sub(1);
+    }
+    snapshot_ = &buffer_.slots_[slot_];
+}
+
+TrajectoryBuffer::ReadGuard::~ReadGuard() {
+    buffer_.readers_[slot_].fetch_sub(1);
+}
+
+TrajectoryBuffer::TrajectoryBuffer(const std::size_t num_samples)
+    : slots_{TrajectorySnapshot(num_samples), TrajectorySnapshot(num_samples), TrajectorySnapshot(num_samples)} {
+    for (auto& readers : readers_) {
+        readers.store(0);
+    }
+}
+
+const bool TrajectoryBuffer::publish(const BaseCubicSpline& trajectory, const double stamp) {
+    const std::size_t current = current_.load();
+    std::size_t slot = current;
+    for (std::size_t attempt = 0; attempt < kPublishAttempts && slot == current; ++attempt) {
+        for (std::size_t i = 1; i < kNumSlots; ++i) {
+            const std::size_t candidate = (current + i) % kNumSlots;
+            if (readers_[candidate].load() == 0) {
+                slot = candidate;
+                break;
+            }
+        }
+        if (slot == current) {
+            std::this_thread::yield();
+        }
+    }
+    if (slot == current) {
+        dropped_.fetch_add(1);
+        return false;
+    }
+    slots_[slot].assign(trajectory, sequence_.load() + 1, stamp);
+    current_.store(slot);
+    sequence_.fetch_add(1);
+    return true;
+}
+
+TrajectoryBuffer::ReadGuard TrajectoryBuffer::read() const {
+    return ReadGuard(*this);
+}
+
+const bool TrajectoryBuffer::sample(const double s, TrajectorySample& sample) const {
+    if (sequence_.load() == 0) {
+        return false;
+    }
+    const ReadGuard snapshot(*this);
+    sample = snapshot->sample(s);
+    return true;
+}
+
+const bool TrajectoryBuffer::closestPoint(const Eigen::Vector2d& point, TrajectorySample& sample, double& distance) const {
+    if (sequence_.load() == 0) {
+        return false;
+    }
+    const ReadGuard snapshot(*this);
+    sample = snapshot->closestPoint(point, distance);
+    return true;
+}
+
+const std::uint64_t TrajectoryBuffer::sequence() const {
+    return sequence_.load();
+}
+
+const std::uint64_t TrajectoryBuffer::dropped() const {
+    return dropped_.load();
+}
+
+} // namespace spline
@@ -0,0 +1,231 @@
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "min_curv_lib/trajectory_ring.hpp"
+
+namespace spline {
+
+namespace {
+const std::size_t slotSize(const std::size_t max_points) {
+    return sizeof(TrajectoryRingSlot) + ((3 * max_points * sizeof(double) + 63) & ~static_cast<std::size_t>(63));
+}
+
+const std::string segmentName(const std::string& name) {
+    return name.empty() || name.front() == '/' ? name : "/" + name;
+}
+
+const char* slotData(const char* data, const TrajectoryRingHeader& header, const std::uint64_t index) {
+    return data + sizeof(TrajectoryRingHeader) + (index % header.num_slots) * header.slot_size;
+}
+
+const bool matchesLayout(const TrajectoryRingHeader& header, const std::size_t num_slots, const std::size_t max_points) {
+    return std::memcmp(header.magic, kTrajectoryRingMagic, sizeof(kTrajectoryRingMagic)) == 0 &&
+           header.version == kTrajectoryRingVersion && header.num_slots == num_slots &&
+           header.max_points == max_points && header.slot_size == slotSize(max_points);
+}
+} // namespace
+
+TrajectoryRingWriter::TrajectoryRingWriter(const std::string& name, const std::size_t num_slots, const std::size_t max_points)
+    : name_(segmentName(name)) {
+    if (num_slots == 0 || max_points == 0) {
+        throw std::invalid_argument("Trajectory ring needs at least one slot and one point.");
+    }
+    size_ = sizeof(TrajectoryRingHeader) + num_slots * slotSize(max_points);
+
+    // An existing ring of the same layout is continued so that readers keep counting, any other
+    // segment is replaced: readers still mapping it keep their (stale) view instead of faulting
+    int file_descriptor = shm_open(name_.c_str(), O_RDWR, 0644);
+    if (file_descriptor >= 0) {
+        struct stat file_stat;
+        bool reuse = fstat(file_descriptor, &file_stat) == 0 && static_cast<std::size_t>(file_stat.st_size) == size_;
+        if (reuse) {
+            void* mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+            if (mapping != MAP_FAILED) {
+                data_ = static_cast<char*>(mapping);
+                header_ = reinterpret_cast<TrajectoryRingHeader*>(data_);
+                reuse = matchesLayout(*header_, num_slots, max_points);
+                if (!reuse) {
+                    munmap(data_, size_);
+                    data_ = nullptr;
+                    header_ = nullptr;
+                }
+            } else {
+                reuse = false;
+            }
+        }
+        close(file_descriptor);
+        if (reuse) {
+            // A writer that died inside a slot left its sequence odd. The slot no longer holds any
+            // trajectory, and it is closed so that readers do not wait for it.
+            for (std::size_t k = 0; k < num_slots; ++k) {
+                auto* slot = reinterpret_cast<TrajectoryRingSlot*>(data_ + sizeof(TrajectoryRingHeader) + k * header_->slot_size);
+                const std::uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+                if (sequence % 2 == 1) {
+                    slot->index = std::numeric_limits<std::uint64_t>::max();
+                    slot->sequence.store(sequence + 1, std::memory_order_release);
+                }
+            }
+            return;
+        }
+        shm_unlink(name_.c_str());
+    }
+
+    file_descriptor = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("Could not create shared memory segment " + name_);
+    }
+    if (ftruncate(file_descriptor, static_cast<off_t>(size_)) != 0) {
+        close(file_descriptor);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("Could not size shared memory segment " + name_);
+    }
+    void* mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("Could not map shared memory segment " + name_);
+    }
+    // ftruncate zero-fills, so every slot starts with an even sequence and no points
+    data_ = static_cast<char*>(mapping);
+    header_ = reinterpret_cast<TrajectoryRingHeader*>(data_);
+    header_->version = kTrajectoryRingVersion;
+    header_->num_slots = static_cast<std::uint32_t>(num_slots);
+    header_->max_points = static_cast<std::uint32_t>(max_points);
+    header_->slot_size = static_cast<std::uint32_t>(slotSize(max_points));
+    header_->write_count.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, kTrajectoryRingMagic, sizeof(kTrajectoryRingMagic));
+}
+
+TrajectoryRingWriter::~TrajectoryRingWriter() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+void TrajectoryRingWriter::write(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature,
+                                 const double stamp) {
+    const std::uint64_t index = header_->write_count.load(std::memory_order_relaxed);
+    char* slot_data = data_ + sizeof(TrajectoryRingHeader) + (index % header_->num_slots) * header_->slot_size;
+    auto* slot = reinterpret_cast<TrajectoryRingSlot*>(slot_data);
+    const std::size_t max_points = header_->max_points;
+    const std::size_t num_points = std::min(points.size(), max_points);
+    double* x = reinterpret_cast<double*>(slot_data + sizeof(TrajectoryRingSlot));
+    double* y = x + max_points;
+    double* k = y + max_points;
+
+    // Odd while writing even if a previous writer left the slot odd
+    const std::uint64_t sequence = slot->sequence.load(std::memory_order_relaxed) | 1;
+    slot->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->index = index;
+    slot->stamp = stamp;
+    slot->num_points = static_cast<std::uint32_t>(num_points);
+    for (std::size_t i = 0; i < num_points; ++i) {
+        x[i] = points[i].x();
+        y[i] = points[i].y();
+        k[i] = i < curvature.size() ? curvature[i] : 0.0;
+    }
+    slot->sequence.store(sequence + 1, std::memory_order_release);
+    header_->write_count.store(index + 1, std::memory_order_release);
+}
+
+const std::uint64_t TrajectoryRingWriter::writeCount() const {
+    return header_->write_count.load(std::memory_order_acquire);
+}
+
+void TrajectoryRingWriter::unlink(const std::string& name) {
+    shm_unlink(segmentName(name).c_str());
+}
+
+TrajectoryRingReader::TrajectoryRingReader(const std::string& name) {
+    const std::string segment = segmentName(name);
+    const int file_descriptor = shm_open(segment.c_str(), O_RDONLY, 0);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("Could not open shared memory segment " + segment);
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || static_cast<std::size_t>(file_stat.st_size) < sizeof(TrajectoryRingHeader)) {
+        close(file_descriptor);
+        throw std::runtime_error("Shared memory segment " + segment + " is too small.");
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map shared memory segment " + segment);
+    }
+    data_ = static_cast<const char*>(mapping);
+    header_ = reinterpret_cast<const TrajectoryRingHeader*>(data_);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!matchesLayout(*header_, header_->num_slots, header_->max_points) || header_->num_slots == 0 ||
+        sizeof(TrajectoryRingHeader) + static_cast<std::size_t>(header_->num_slots) * header_->slot_size != size_) {
+        munmap(const_cast<char*>(data_), size_);
+        throw std::runtime_error(segment + " is not a trajectory ring of version " + std::to_string(kTrajectoryRingVersion) + ".");
+    }
+}
+
+TrajectoryRingReader::~TrajectoryRingReader() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+const std::uint64_t TrajectoryRingReader::writeCount() const {
+    return header_->write_count.load(std::memory_order_acquire);
+}
+
+const bool TrajectoryRingReader::read(const std::uint64_t index, RingTrajectory& trajectory) const {
+    const char* slot_data = slotData(data_, *header_, index);
+    const auto* slot = reinterpret_cast<const TrajectoryRingSlot*>(slot_data);
+    const std::size_t max_points = header_->max_points;
+    const double* x = reinterpret_cast<const double*>(slot_data + sizeof(TrajectoryRingSlot));
+    const double* y = x + max_points;
+    const double* k = y + max_points;
+
+    for (std::size_t attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        if (index >= writeCount()) {
+            return false;
+        }
+        const std::uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence % 2 == 1) {
+            continue;
+        }
+        const std::uint64_t slot_index = slot->index;
+        const std::size_t num_points = std::min<std::size_t>(slot->num_points, max_points);
+        trajectory.index = slot_index;
+        trajectory.stamp = slot->stamp;
+        trajectory.points.resize(num_points);
+        trajectory.curvature.resize(num_points);
+        for (std::size_t i = 0; i < num_points; ++i) {
+            trajectory.points[i] = Eigen::Vector2d(x[i], y[i]);
+            trajectory.curvature[i] = k[i];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        // A stable slot holding another trajectory means ours has been overwritten
+        return slot_index == index;
+    }
+    return false;
+}
+
+const bool TrajectoryRingReader::readLatest(RingTrajectory& trajectory) const {
+    for (std::size_t attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        const std::uint64_t count = writeCount();
+        if (count == 0) {
+            return false;
+        }
+        if (read(count - 1, trajectory)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace spline
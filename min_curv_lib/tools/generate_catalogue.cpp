@@ -0,0 +1,124 @@
+// Offline raceline generation for a whole map catalogue, tracks are solved in parallel worker processes
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/cubic_spline.hpp"
+#include "min_curv_lib/cubic_b_spline.hpp"
+#include "min_curv_lib/process_dispatcher.hpp"
+#include "min_curv_lib/raceline.hpp"
+#include "min_curv_lib/track_io.hpp"
+
+struct CatalogueEntry
+{
+    std::string left_file;
+    std::string right_file;
+    std::string raceline_file;
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <catalogue.txt> [num_workers=4] [num_control_points=100]"
+                  << " [num_samples=1000] [weight=0.5] [max_retries=2] [timeout_s=0]\n"
+                  << "Each catalogue line: <left_boundary.txt> <right_boundary.txt> <raceline.txt>\n";
+        return 1;
+    }
+    const std::size_t num_workers = argc > 2 ? std::stoul(argv[2]) : 4;
+    const std::size_t num_control_points = argc > 3 ? std::stoul(argv[3]) : 100;
+    const std::size_t num_samples = argc > 4 ? std::stoul(argv[4]) : 1000;
+    const double weight = argc > 5 ? std::stod(argv[5]) : 0.5;
+    const std::size_t max_retries = argc > 6 ? std::stoul(argv[6]) : 2;
+    const double timeout = argc > 7 ? 1000.0 * std::stod(argv[7]) : 0.0;
+
+    std::vector<CatalogueEntry> entries;
+    std::ifstream catalogue(argv[1]);
+    if (!catalogue) {
+        std::cerr << "Could not open " << argv[1] << "\n";
+        return 1;
+    }
+    for (std::string line; std::getline(catalogue, line);) {
+        std::istringstream fields(line);
+        CatalogueEntry entry;
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        if (!(fields >> entry.left_file >> entry.right_file >> entry.raceline_file)) {
+            std::cerr << "Skipping malformed catalogue line: " << line << "\n";
+            continue;
+        }
+        entries.push_back(entry);
+    }
+
+    // Same parameters as generate_raceline
+    auto params = std::make_unique<spline::optimization::ProcessDispatcherParams>();
+    params->num_workers = num_workers;
+    params->max_retries = max_retries;
+    params->timeout = timeout;
+    params->optimizer.num_control_points = num_control_points;
+    params->optimizer.num_points_evaluate = 10 * num_control_points;
+    params->optimizer.num_nearest = 10;
+    params->optimizer.shrink = 0.2;
+    params->optimizer.max_num_iterations = 1000;
+
+    // Boundaries are read before forking, a track that cannot be read is reported and left out
+    std::vector<spline::optimization::CorridorRequest> requests;
+    std::vector<CatalogueEntry> tracks;
+    for (const auto& entry : entries) {
+        try {
+            spline::optimization::CorridorRequest request;
+            request.left_boundary = spline::resamplePolyline(spline::loadPoints(entry.left_file), num_control_points);
+            request.right_boundary = spline::resamplePolyline(spline::loadPoints(entry.right_file), num_control_points);
+            for (std::size_t i = 0; i < num_control_points; ++i) {
+                request.centerline.push_back((request.left_boundary[i] + request.right_boundary[i]) / 2);
+            }
+            // The last point is free on a full lap
+            request.weight = weight;
+            request.last_point_shrink = 1.0;
+            requests.push_back(request);
+            tracks.push_back(entry);
+        } catch (const std::exception& e) {
+            std::cerr << entry.raceline_file << ": " << e.what() << "\n";
+        }
+    }
+
+    std::size_t solved = 0;
+    try {
+        spline::optimization::ProcessDispatcher dispatcher(std::move(params));
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = dispatcher.solve(requests);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (std::size_t t = 0; t < tracks.size(); ++t) {
+            if (!results[t].success) {
+                std::cerr << tracks[t].raceline_file << ": " << results[t].message << "\n";
+                continue;
+            }
+            // Sampled like generate_raceline, u = 1 is left out of the B-spline basis
+            const spline::CubicBSpline raceline_spline(results[t].control_points);
+            const spline::ParametricCubicSpline centerline_spline(requests[t].centerline);
+            std::vector<Eigen::Vector2d> points(num_samples);
+            std::vector<double> curvature(num_samples);
+            std::vector<Eigen::Vector2d> centerline(num_samples);
+            for (std::size_t i = 0; i < num_samples; ++i) {
+                const double u = static_cast<double>(i) / num_samples;
+                points[i] = raceline_spline.evaluateSpline(u, 0);
+                curvature[i] = raceline_spline.computeCurvature(u);
+                centerline[i] = centerline_spline.evaluateSpline(u, 0);
+            }
+            spline::optimization::Raceline::save(tracks[t].raceline_file, points, curvature, centerline);
+            std::cout << tracks[t].raceline_file << ": solved in " << results[t].setup_time + results[t].solve_time << " ms\n";
+            ++solved;
+        }
+        std::cout << solved << "/" << entries.size()
+                  << " tracks in " << elapsed << " s on " << num_workers << " workers, "
+                  << dispatcher.getRestarts() << " worker restarts\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Catalogue generation failed: " << e.what() << "\n";
+        return 1;
+    }
+    return solved == entries.size() ? 0 : 1;
+}
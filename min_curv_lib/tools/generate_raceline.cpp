@@ -0,0 +1,131 @@
+// Offline full-track raceline generation for the raceline mode of the ROS wrapper
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "min_curv_lib/cubic_spline.hpp"
+#include "min_curv_lib/cubic_b_spline.hpp"
+#include "min_curv_lib/curv_min.hpp"
+#include "min_curv_lib/raceline.hpp"
+#include "min_curv_lib/track_io.hpp"
+#include "min_curv_lib/track_map.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <left_boundary.txt> <right_boundary.txt> <raceline.txt>"
+                  << " [num_control_points=100] [num_samples=1000] [weight=0.5]"
+                  << " [track_map.bin] [online_num_control_points=20,...] [closed=1]\n";
+        return 1;
+    }
+    const std::size_t num_control_points = argc > 4 ? std::stoul(argv[4]) : 100;
+    const std::size_t num_samples = argc > 5 ? std::stoul(argv[5]) : 1000;
+    const double weight = argc > 6 ? std::stod(argv[6]) : 0.5;
+    const std::string track_map_file = argc > 7 ? argv[7] : "";
+    // System matrix inverses stored in the track map, one per control point count used online
+    std::vector<std::size_t> operator_sizes;
+    std::stringstream sizes(argc > 8 ? argv[8] : "20");
+    for (std::string size; std::getline(sizes, size, ',');) {
+        operator_sizes.push_back(std::stoul(size));
+    }
+    const bool closed = argc > 9 ? std::stoi(argv[9]) != 0 : true;
+
+    try {
+        // A lap is resampled with the closing segment from the last input point back to the first
+        auto resample = [&](std::vector<Eigen::Vector2d> points) {
+            if (!closed) {
+                return spline::resamplePolyline(points, num_control_points);
+            }
+            points.push_back(points.front());
+            auto resampled = spline::resamplePolyline(points, num_control_points + 1);
+            resampled.pop_back();
+            return resampled;
+        };
+        const auto left_boundary = resample(spline::loadPoints(argv[1]));
+        const auto right_boundary = resample(spline::loadPoints(argv[2]));
+        std::vector<Eigen::Vector2d> centerline(num_control_points);
+        for (std::size_t i = 0; i < num_control_points; ++i) {
+            centerline[i] = (left_boundary[i] + right_boundary[i]) / 2;
+        }
+
+        // The optimizer only solves open corridors. A closed lap is unrolled with overlap wrapped around
+        // both ends, and the lap is cut from the middle where the open ends no longer matter. Indices a lap
+        // apart are the same place, so the cut is continuous up to what the overlap leaves of the end effects.
+        const std::size_t overlap = closed ? std::max<std::size_t>(3, num_control_points / 5) : 0;
+        const std::size_t num_unrolled = num_control_points + 2 * overlap + (closed ? 1 : 0);
+        auto unroll = [&](const std::vector<Eigen::Vector2d>& points) {
+            std::vector<Eigen::Vector2d> unrolled(num_unrolled);
+            for (std::size_t i = 0; i < num_unrolled; ++i) {
+                unrolled[i] = points[(i + num_control_points - overlap) % num_control_points];
+            }
+            return unrolled;
+        };
+
+        auto params = std::make_unique<spline::optimization::MinCurvatureParams>();
+        params->num_control_points = num_unrolled;
+        params->num_points_evaluate = 10 * num_unrolled;
+        params->num_nearest = 10;
+        params->shrink = 0.2;
+        params->max_num_iterations = 1000;
+        spline::optimization::MinCurvatureOptimizer optimizer(std::move(params));
+
+        auto centerline_spline = std::make_shared<spline::ParametricCubicSpline>(unroll(centerline));
+        auto left_spline = std::make_shared<spline::ParametricCubicSpline>(left_boundary);
+        auto right_spline = std::make_shared<spline::ParametricCubicSpline>(right_boundary);
+        std::shared_ptr<spline::BaseCubicSpline> optimized = std::make_shared<spline::ParametricCubicSpline>();
+        optimizer.setSplines(centerline_spline,
+                             std::make_shared<spline::ParametricCubicSpline>(unroll(left_boundary)),
+                             std::make_shared<spline::ParametricCubicSpline>(unroll(right_boundary)));
+
+        // Same two pass scheme as the ROS wrapper, the last point is free on a full lap
+        optimizer.setUp(1.0);
+        optimizer.solve(optimized, weight);
+        optimizer.setUp(1.0);
+        optimizer.solve(optimized, 1 - weight);
+        const spline::CubicBSpline raceline_spline(optimized->getControlPoints());
+
+        // Control point i of the clamped uniform B-spline sits at u = (i - 1) / (n - 3) away from the
+        // ends, the centerline passes its point i at u = i / (n - 1). u = 1 is left out, the B-spline
+        // basis is only defined on [0, 1).
+        const double raceline_start = closed ? (overlap - 1.0) / (num_unrolled - 3.0) : 0.0;
+        const double raceline_end = closed ? (overlap + num_control_points - 1.0) / (num_unrolled - 3.0) : 1.0;
+        const double centerline_start = closed ? static_cast<double>(overlap) / (num_unrolled - 1) : 0.0;
+        const double centerline_end = closed ? static_cast<double>(overlap + num_control_points) / (num_unrolled - 1) : 1.0;
+        std::vector<Eigen::Vector2d> points(num_samples);
+        std::vector<double> curvature(num_samples);
+        std::vector<Eigen::Vector2d> map_centerline(num_samples);
+        for (std::size_t i = 0; i < num_samples; ++i) {
+            const double fraction = static_cast<double>(i) / num_samples;
+            const double u = raceline_start + fraction * (raceline_end - raceline_start);
+            points[i] = raceline_spline.evaluateSpline(u, 0);
+            curvature[i] = raceline_spline.computeCurvature(u);
+            map_centerline[i] = centerline_spline->evaluateSpline(centerline_start + fraction * (centerline_end - centerline_start), 0);
+        }
+        if (closed) {
+            std::cout << "Gap at the start/finish line: "
+                      << (raceline_spline.evaluateSpline(raceline_end, 0) - points.front()).norm() << " m\n";
+        }
+        spline::optimization::Raceline::save(argv[3], points, curvature, map_centerline);
+
+        if (!track_map_file.empty()) {
+            spline::optimization::Raceline raceline;
+            raceline.setRaceline(points, curvature, map_centerline);
+            std::map<std::size_t, Eigen::MatrixXd> system_inverses;
+            for (const std::size_t size : operator_sizes) {
+                auto operator_params = std::make_unique<spline::optimization::MinCurvatureParams>();
+                operator_params->constant_system_matrix = true;
+                operator_params->num_control_points = size;
+                const spline::optimization::MinCurvatureOptimizer operator_optimizer(std::move(operator_params));
+                system_inverses[size] = operator_optimizer.getSystemMatrixInverse();
+            }
+            spline::optimization::TrackMap::save(track_map_file, raceline, system_inverses);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Raceline generation failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
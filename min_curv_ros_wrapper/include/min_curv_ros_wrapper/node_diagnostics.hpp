@@ -0,0 +1,92 @@
+#pragma once
+#include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <diagnostic_msgs/KeyValue.h>
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace min_curv_ros_wrapper {
+
+// Log-scale histogram of durations. record() is lock-free, collect() is called from a single
+// thread, moves the counts since its previous call into a ring of intervals and summarizes the
+// last window_size intervals, so percentiles cover a rolling window of reports.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        double p50 = 0.0;  // [ms]
+        double p99 = 0.0;  // [ms]
+        double max = 0.0;  // [ms]
+    };
+
+    LatencyHistogram();
+    void record(const double seconds);
+    Summary collect();
+    // Number of collect() intervals a summary covers, 1 reports only the time since the previous call
+    void setWindowSize(const std::size_t window_size);
+
+private:
+    // Four buckets per octave starting at 1us, the last one collects everything above ~12s
+    static constexpr std::size_t kNumBuckets = 96;
+    static constexpr std::size_t kBucketsPerOctave = 4;
+
+    struct Interval {
+        std::array<uint64_t, kNumBuckets> counts{};
+        uint64_t max_ns = 0;
+    };
+
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+    std::atomic<uint64_t> max_ns_;
+    std::vector<Interval> intervals_;
+    std::size_t next_interval_ = 0;
+};
+
+// Latency, stage timings, input rate and drops of the node, published on /diagnostics
+class NodeDiagnostics {
+public:
+    // NearHorizon covers solving and publishing the window of the progressive mode
+    enum Stage { Preprocessing = 0, Optimization, Sampling, Publishing, Callback, NearHorizon, NumStages };
+    // Corridor topics, each with its own header sequence
+    enum Input { Boundaries = 0, CorridorWidths, NumInputs };
+
+    NodeDiagnostics(const std::string& name);
+
+    // Reports over which the latency percentiles are computed, rates and counters cover one report
+    void setWindowSize(const std::size_t reports);
+
+    // Called for every corridor message, gaps in the header sequence of a topic reveal dropped inputs
+    void recordInput(const Input input, const uint32_t seq);
+    void recordStage(const Stage stage, const double seconds);
+    // Delay between the input header stamp and the moment the output was published
+    void recordEndToEnd(const ros::Time& input_stamp);
+    // Page faults, preemptions and migrations of the optimizer thread during one solve
+    void recordSolveActivity(const uint64_t page_faults, const uint64_t preemptions, const bool migrated);
+    // Running totals of the optimizer's solution cache, reported as they are
+    void recordCacheStats(const uint64_t hits, const uint64_t misses, const double saved_time);
+
+    const diagnostic_msgs::DiagnosticStatus collect(const double period);
+
+private:
+    const LatencyHistogram::Summary addSummary(diagnostic_msgs::DiagnosticStatus& status, const std::string& name,
+                                               LatencyHistogram& histogram) const;
+
+    std::string name_;
+    LatencyHistogram end_to_end_;
+    std::array<LatencyHistogram, NumStages> stages_;
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::array<std::atomic<int64_t>, NumInputs> last_seq_{{-1, -1}};
+    std::atomic<uint64_t> solves_{0};
+    std::atomic<uint64_t> page_faults_{0};
+    std::atomic<uint64_t> preempted_solves_{0};
+    std::atomic<uint64_t> migrated_solves_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> cache_misses_{0};
+    std::atomic<double> cache_saved_time_{0.0};
+};
+
+} // namespace min_curv_ros_wrapper
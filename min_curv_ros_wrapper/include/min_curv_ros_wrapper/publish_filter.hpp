@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <Eigen/Dense>
+
+namespace min_curv_ros_wrapper {
+
+// Decides whether a new trajectory is worth publishing. It is compared with the last published one in
+// both directions: the deviation is the largest distance of the samples of either path to the other
+// polyline, the curvature change the largest difference to the other's curvature at the nearest point.
+// The lengths of both paths are compared against the deviation threshold as well, so a horizon that got
+// shorter or longer counts as changed. Trajectories below all thresholds are suppressed until the
+// keep-alive period has passed since the last publication. One filter per stream of trajectories.
+class PublishFilter {
+public:
+    struct Change {
+        double deviation = 0.0;         // [m]
+        double curvature_change = 0.0;  // [1/m]
+        double length_change = 0.0;     // [m]
+    };
+
+    // keep_alive in seconds, 0 suppresses unchanged trajectories indefinitely
+    PublishFilter(const double max_deviation, const double max_curvature_change, const double keep_alive);
+
+    // True if the trajectory is to be published, it then becomes the reference for the next ones
+    const bool accept(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature);
+    // Comparison behind the last decision, zero if there was nothing to compare with
+    const Change& getLastChange() const;
+    const std::size_t getAccepted() const;
+    const std::size_t getSuppressed() const;
+
+private:
+    const Change compare(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature) const;
+    // Deviation and curvature change of points from the reference path, length_change stays zero
+    static const Change directedChange(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature,
+                                       const std::vector<Eigen::Vector2d>& reference_points,
+                                       const std::vector<double>& reference_curvature);
+    static const double length(const std::vector<Eigen::Vector2d>& points);
+
+    double max_deviation_;
+    double max_curvature_change_;
+    std::chrono::duration<double> keep_alive_;
+    std::vector<Eigen::Vector2d> published_points_;
+    std::vector<double> published_curvature_;
+    std::chrono::steady_clock::time_point published_time_;
+    Change last_change_;
+    std::size_t accepted_ = 0;
+    std::size_t suppressed_ = 0;
+};
+
+} // namespace min_curv_ros_wrapper
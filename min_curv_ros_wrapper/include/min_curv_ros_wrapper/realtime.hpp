@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <sys/resource.h>
+
+namespace min_curv_ros_wrapper {
+
+// Locks every current and future page of the process into RAM and keeps freed heap memory mapped, so
+// buffers grown once by the warm-up solves are never faulted in again. Throws std::runtime_error if the
+// process lacks CAP_IPC_LOCK and the memlock limit is too small.
+void lockMemory();
+
+// Pins the calling thread to the given cores (empty keeps its affinity) and runs it under SCHED_FIFO at
+// the given priority (0 keeps SCHED_OTHER). Throws std::runtime_error on invalid cores or without CAP_SYS_NICE.
+void configureThread(const std::vector<int>& cpus, const int priority);
+
+// Disturbances the calling thread saw while solving
+struct ThreadActivity
+{
+    uint64_t page_faults = 0;  // Minor and major
+    uint64_t preemptions = 0;  // Involuntary context switches
+    bool migrated = false;     // Finished on another core than it started on
+};
+
+// Reads the resource usage of the calling thread around a section of work, start() and stop() must run on
+// the same thread. Migrations in between that return to the starting core are not seen.
+class ThreadActivityMonitor {
+public:
+    void start();
+    const ThreadActivity stop() const;
+
+private:
+    rusage start_usage_{};
+    int start_cpu_ = -1;
+};
+
+} // namespace min_curv_ros_wrapper
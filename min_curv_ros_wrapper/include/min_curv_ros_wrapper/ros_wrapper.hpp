@@ -1,58 +1,125 @@
 #pragma once
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/Float64.h>
 #include <geometry_msgs/Point.h>
 #include <nav_msgs/Path.h>
+#include <nav_msgs/OccupancyGrid.h>
 #include <Eigen/Dense>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "min_curv_msgs/Paths.h" 
+#include "min_curv_msgs/CorridorWidths.h"
+#include "min_curv_msgs/BSplineTrajectory.h"
+#include "min_curv_msgs/OptimizeCorridor.h"
 #include "min_curv_lib/base_cubic_spline.hpp"
 #include "min_curv_lib/cubic_spline.hpp"
 #include "min_curv_lib/cubic_b_spline.hpp"
+#include "min_curv_lib/b_spline_evaluator.hpp"
 #include "min_curv_lib/curv_min.hpp"
+#include "min_curv_lib/distance_field.hpp"
+#include "min_curv_lib/batch_optimizer.hpp"
+#include "min_curv_lib/raceline.hpp"
+#include "min_curv_lib/track_map.hpp"
+#include "min_curv_lib/trajectory_buffer.hpp"
+#include "min_curv_lib/trajectory_ring.hpp"
+#include "min_curv_lib/control_point_placement.hpp"
+#include "min_curv_ros_wrapper/node_diagnostics.hpp"
+#include "min_curv_ros_wrapper/realtime.hpp"
+#include "min_curv_ros_wrapper/publish_filter.hpp"
 
 namespace min_curv_ros_wrapper {
 
 class RosWrapper {
 public:
     RosWrapper(ros::NodeHandle& nh);
+    ~RosWrapper();
     
     // Callback functions for subscribers
     void boundariesCallback(const min_curv_msgs::Paths::ConstPtr& msg);
+    // Map-based corridor given as centerline and widths, no boundary distance search
+    void corridorWidthsCallback(const min_curv_msgs::CorridorWidths::ConstPtr& msg);
+    // Obstacles for distance field corridors, transformed once per grid and used by the following boundaries
+    void occupancyGridCallback(const nav_msgs::OccupancyGrid::ConstPtr& msg);
+
+    // On-demand optimization service, concurrent calls are batched
+    bool optimizeCorridorCallback(min_curv_msgs::OptimizeCorridor::Request& req,
+                                  min_curv_msgs::OptimizeCorridor::Response& res);
+
+    // Latest optimized trajectory for in-process consumers such as a controller, queried without locks
+    std::shared_ptr<const spline::TrajectoryBuffer> getTrajectoryBuffer() const;
 
     // Publish results (optimized path and curvatures)
     void publish(const std::vector<Eigen::Vector2d>& opt_points,
                  const std::vector<Eigen::Vector2d>& left_boundary,
                  const std::vector<Eigen::Vector2d>& right_boundary,
                  const std::vector<double>& init_curv,
-                 const std::vector<double>& opt_curv) const;
+                 const std::vector<double>& opt_curv);
 
 private:
+    // Optimized path and its curvature, without the boundaries. The full horizon also goes into the shared
+    // memory ring, the near-horizon window only onto its own topics.
+    void publishTrajectory(const std::vector<Eigen::Vector2d>& opt_points, const std::vector<double>& opt_curv,
+                           const bool near_horizon);
+    // In-process snapshot for controllers, warns when slow readers made the buffer drop it
+    void publishSnapshot(const spline::BaseCubicSpline& trajectory);
+    // Control points of the optimized B-spline with its length and largest curvature on the compact topic
+    void publishSpline(const std::vector<Eigen::Vector2d>& control_points, const bool near_horizon);
+    // False if the publish filter suppresses the trajectory as unchanged, true without a filter
+    const bool acceptTrajectory(const std::vector<Eigen::Vector2d>& opt_points, const std::vector<double>& opt_curv,
+                                const bool near_horizon);
     void optimizeTrajectory();
+    // Solves and publishes the first control points of the corridor, returns the displacements the full horizon keeps
+    const Eigen::MatrixXd publishNearHorizon();
+    void diagnosticsCallback(const ros::TimerEvent& event);
+    const bool publishRacelineWindow(const std::vector<Eigen::Vector2d>& centerline);
     void subscribeAndAdvertise();
     void initialize();
+    // Real-time mode: serves the corridor callbacks on one pinned thread after locking memory and warming up
+    void optimizerThread();
+    // Solves a synthetic corridor so the solver workspaces and sampling buffers are allocated before the first input
+    void warmUp();
 
     ros::NodeHandle nh_;
+    // Handle and queue of the corridor subscriptions in real-time mode, everything else stays on the spinner
+    ros::NodeHandle optimizer_nh_;
+    ros::CallbackQueue optimizer_queue_;
+    std::thread optimizer_thread_;
     ros::Subscriber boundaries_sub_;
+    ros::Subscriber corridor_widths_sub_;
+    ros::Subscriber occupancy_grid_sub_;
+    ros::ServiceServer optimize_corridor_srv_;
 
     struct Publishers {
         ros::Publisher optimized_path;
         ros::Publisher initial_curvature;
         ros::Publisher optimized_curvature;
+        ros::Publisher optimized_spline;
+        ros::Publisher near_horizon_path;
+        ros::Publisher near_horizon_curvature;
         ros::Publisher left_boundary;
         ros::Publisher right_boundary;
+        ros::Publisher diagnostics;
     } pub_;
 
     struct Topics {
         std::string boundaries;
+        std::string corridor_widths;
+        std::string occupancy_grid;
         std::string optimized_path;
         std::string initial_curvature;
         std::string optimized_curvature;
+        std::string optimized_spline;
+        std::string near_horizon_path;
+        std::string near_horizon_curvature;
         std::string left_boundary;
         std::string right_boundary;
+        std::string optimize_corridor;
+        std::string diagnostics;
     } topics_;
 
     struct Frames {
@@ -63,19 +130,69 @@ private:
     struct OptimizerParams {
         double weight;
         double last_point_shrink;
+        // Curvature-adaptive redistribution of the centerline control points
+        bool adaptive_placement;
+        double curvature_gain;
+        std::size_t num_control_points;
     } optimizer_params_;
 
+    // Corridor bounds from a signed distance field instead of the nearest boundary points
+    struct CorridorParams {
+        bool distance_field;
+        bool use_occupancy_grid;
+        double resolution;
+        double margin;
+    } corridor_params_;
+    // Progressive mode: a short near-horizon window is solved and published before the full horizon
+    struct ProgressiveParams {
+        bool enabled;
+        std::size_t num_control_points;
+    } progressive_params_;
+    // Real-time mode: corridor callbacks on a dedicated thread with locked memory, pinned cores and SCHED_FIFO
+    struct RealtimeParams {
+        bool enabled;
+        bool lock_memory;
+        std::vector<int> cpus;
+        int priority;
+        std::size_t warmup_solves;
+    } realtime_params_;
+    std::shared_ptr<spline::ParametricCubicSpline> near_centerline_spline_;
+    std::unique_ptr<spline::optimization::MinCurvatureOptimizer> near_optimizer_;
+    // Held by the boundaries and corridor widths callbacks, which may run on different spinner threads
+    std::mutex corridor_mutex_;
+    std::mutex occupancy_field_mutex_;
+    std::shared_ptr<const spline::optimization::DistanceField> occupancy_field_;
+
     // Save boundaries time
     ros::Time boundaries_time_;
 
     // Internal data storage for boundaries and centerline splines
-    std::shared_ptr<spline::BaseCubicSpline> centerline_spline_;
+    std::shared_ptr<spline::ParametricCubicSpline> centerline_spline_;
     std::shared_ptr<spline::BaseCubicSpline> left_boundary_spline_;
     std::shared_ptr<spline::BaseCubicSpline> right_boundary_spline_;
     std::shared_ptr<spline::BaseCubicSpline> optimized_trajectory_;
 
     // Solver pointer
     std::unique_ptr<spline::optimization::MinCurvatureOptimizer> optimizer_;
+    // Precomputed raceline of a known track, only loaded in raceline mode
+    std::unique_ptr<spline::optimization::Raceline> raceline_;
+
+    // Batched optimizer serving the optimize corridor service
+    std::unique_ptr<spline::optimization::BatchOptimizer> batch_optimizer_;
+
+    // Skips publishing trajectories that barely differ from the last published one of the same stream, only
+    // created if enabled
+    std::unique_ptr<PublishFilter> publish_filter_;
+    std::unique_ptr<PublishFilter> near_publish_filter_;
+
+    std::shared_ptr<spline::TrajectoryBuffer> trajectory_buffer_;
+    // Shared memory ring for local non-ROS consumers, only created if a segment name is set
+    std::unique_ptr<spline::TrajectoryRingWriter> trajectory_ring_;
+
+    // Latency and throughput statistics, published periodically on the diagnostics topic
+    NodeDiagnostics diagnostics_;
+    ros::Timer diagnostics_timer_;
+    double diagnostics_rate_;
 };
 
 } // namespace min_curv_ros_wrapper
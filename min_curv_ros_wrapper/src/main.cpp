@@ -8,7 +8,12 @@ int main(int argc, char** argv) {
 
     min_curv_ros_wrapper::RosWrapper ros_wrapper(nh);
 
-    ros::spin();  // Keep the node alive and responsive to callbacks
+    // Several spinner threads so that concurrent service calls can be batched together
+    int spinner_threads;
+    nh.param<int>("spinner_threads", spinner_threads, 4);
+    ros::AsyncSpinner spinner(spinner_threads);
+    spinner.start();
+    ros::waitForShutdown();  // Keep the node alive and responsive to callbacks
 
     return 0;
 }
@@ -0,0 +1,216 @@
+#include "min_curv_ros_wrapper/node_diagnostics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+namespace min_curv_ros_wrapper {
+
+LatencyHistogram::LatencyHistogram() : max_ns_(0), intervals_(1) {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::setWindowSize(const std::size_t window_size) {
+    intervals_.assign(std::max<std::size_t>(1, window_size), Interval());
+    next_interval_ = 0;
+}
+
+void LatencyHistogram::record(const double seconds) {
+    const double microseconds = std::max(0.0, seconds * 1e6);
+    std::size_t bucket = 0;
+    if (microseconds > 1.0) {
+        bucket = std::min(kNumBuckets - 1, static_cast<std::size_t>(std::log2(microseconds) * kBucketsPerOctave) + 1);
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    const uint64_t nanoseconds = static_cast<uint64_t>(microseconds * 1e3);
+    uint64_t current_max = max_ns_.load(std::memory_order_relaxed);
+    while (nanoseconds > current_max &&
+           !max_ns_.compare_exchange_weak(current_max, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::collect() {
+    // Replace the oldest interval with the counts recorded since the previous call
+    Interval& latest = intervals_[next_interval_];
+    next_interval_ = (next_interval_ + 1) % intervals_.size();
+    for (std::size_t i = 0; i < kNumBuckets; ++i) {
+        latest.counts[i] = buckets_[i].exchange(0, std::memory_order_relaxed);
+    }
+    latest.max_ns = max_ns_.exchange(0, std::memory_order_relaxed);
+
+    std::array<uint64_t, kNumBuckets> counts{};
+    uint64_t max_ns = 0;
+    Summary summary;
+    for (const auto& interval : intervals_) {
+        for (std::size_t i = 0; i < kNumBuckets; ++i) {
+            counts[i] += interval.counts[i];
+            summary.count += interval.counts[i];
+        }
+        max_ns = std::max(max_ns, interval.max_ns);
+    }
+    summary.max = max_ns * 1e-6;
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    // Percentiles are reported as the upper edge of their bucket, capped by the maximum
+    auto percentile = [&](const double fraction) {
+        const uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * summary.count));
+        uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < kNumBuckets; ++i) {
+            cumulative += counts[i];
+            if (cumulative >= rank) {
+                const double upper_edge = std::pow(2.0, static_cast<double>(i) / kBucketsPerOctave) * 1e-3;
+                return std::min(upper_edge, summary.max);
+            }
+        }
+        return summary.max;
+    };
+    summary.p50 = percentile(0.5);
+    summary.p99 = percentile(0.99);
+    return summary;
+}
+
+NodeDiagnostics::NodeDiagnostics(const std::string& name) : name_(name) {}
+
+void NodeDiagnostics::setWindowSize(const std::size_t reports) {
+    end_to_end_.setWindowSize(reports);
+    for (auto& stage : stages_) {
+        stage.setWindowSize(reports);
+    }
+}
+
+void NodeDiagnostics::recordInput(const Input input, const uint32_t seq) {
+    received_.fetch_add(1, std::memory_order_relaxed);
+    const int64_t last_seq = last_seq_[input].exchange(seq, std::memory_order_relaxed);
+    // Gaps in the publisher's sequence numbers are messages the subscriber queue dropped
+    if (last_seq >= 0 && seq > last_seq + 1) {
+        dropped_.fetch_add(seq - last_seq - 1, std::memory_order_relaxed);
+    }
+}
+
+void NodeDiagnostics::recordStage(const Stage stage, const double seconds) {
+    stages_[stage].record(seconds);
+}
+
+void NodeDiagnostics::recordEndToEnd(const ros::Time& input_stamp) {
+    if (!input_stamp.isZero()) {
+        end_to_end_.record((ros::Time::now() - input_stamp).toSec());
+    }
+}
+
+void NodeDiagnostics::recordSolveActivity(const uint64_t page_faults, const uint64_t preemptions, const bool migrated) {
+    solves_.fetch_add(1, std::memory_order_relaxed);
+    page_faults_.fetch_add(page_faults, std::memory_order_relaxed);
+    if (preemptions > 0) {
+        preempted_solves_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (migrated) {
+        migrated_solves_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void NodeDiagnostics::recordCacheStats(const uint64_t hits, const uint64_t misses, const double saved_time) {
+    cache_hits_.store(hits, std::memory_order_relaxed);
+    cache_misses_.store(misses, std::memory_order_relaxed);
+    cache_saved_time_.store(saved_time, std::memory_order_relaxed);
+}
+
+const LatencyHistogram::Summary NodeDiagnostics::addSummary(diagnostic_msgs::DiagnosticStatus& status, const std::string& name,
+                                                            LatencyHistogram& histogram) const {
+    const auto summary = histogram.collect();
+    auto add_value = [&status](const std::string& key, const double value) {
+        diagnostic_msgs::KeyValue key_value;
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(3) << value;
+        key_value.key = key;
+        key_value.value = stream.str();
+        status.values.push_back(key_value);
+    };
+    add_value(name + " p50 [ms]", summary.p50);
+    add_value(name + " p99 [ms]", summary.p99);
+    add_value(name + " max [ms]", summary.max);
+    return summary;
+}
+
+const diagnostic_msgs::DiagnosticStatus NodeDiagnostics::collect(const double period) {
+    static const char* stage_names[NumStages] = {"preprocessing", "optimization", "sampling", "publishing", "callback",
+                                                 "near horizon"};
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = name_;
+    status.hardware_id = name_;
+    const uint64_t received = received_.exchange(0, std::memory_order_relaxed);
+    const uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    const double input_rate = period > 0.0 ? received / period : 0.0;
+    const double drop_rate = received + dropped > 0 ? static_cast<double>(dropped) / (received + dropped) : 0.0;
+
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = "input rate [Hz]";
+    key_value.value = std::to_string(input_rate);
+    status.values.push_back(key_value);
+    key_value.key = "drop rate";
+    key_value.value = std::to_string(drop_rate);
+    status.values.push_back(key_value);
+
+    addSummary(status, "end to end", end_to_end_);
+    LatencyHistogram::Summary optimization;
+    for (std::size_t stage = 0; stage < NumStages; ++stage) {
+        const auto summary = addSummary(status, stage_names[stage], stages_[stage]);
+        if (stage == Optimization) {
+            optimization = summary;
+        }
+    }
+
+    // Jitter is the spread of the solve time, the counters show what caused it
+    const uint64_t solves = solves_.exchange(0, std::memory_order_relaxed);
+    const uint64_t page_faults = page_faults_.exchange(0, std::memory_order_relaxed);
+    key_value.key = "optimization jitter (p99 - p50) [ms]";
+    key_value.value = std::to_string(optimization.p99 - optimization.p50);
+    status.values.push_back(key_value);
+    key_value.key = "page faults per solve";
+    key_value.value = std::to_string(solves > 0 ? static_cast<double>(page_faults) / solves : 0.0);
+    status.values.push_back(key_value);
+    key_value.key = "preempted solves";
+    key_value.value = std::to_string(preempted_solves_.exchange(0, std::memory_order_relaxed));
+    status.values.push_back(key_value);
+    key_value.key = "migrated solves";
+    key_value.value = std::to_string(migrated_solves_.exchange(0, std::memory_order_relaxed));
+    status.values.push_back(key_value);
+
+    // Solution cache totals since startup, only once the cache has been used
+    const uint64_t cache_hits = cache_hits_.load(std::memory_order_relaxed);
+    const uint64_t cache_misses = cache_misses_.load(std::memory_order_relaxed);
+    if (cache_hits + cache_misses > 0) {
+        key_value.key = "cache hit rate";
+        key_value.value = std::to_string(static_cast<double>(cache_hits) / (cache_hits + cache_misses));
+        status.values.push_back(key_value);
+        key_value.key = "cache hits";
+        key_value.value = std::to_string(cache_hits);
+        status.values.push_back(key_value);
+        key_value.key = "cache misses";
+        key_value.value = std::to_string(cache_misses);
+        status.values.push_back(key_value);
+        key_value.key = "cache saved time [ms]";
+        key_value.value = std::to_string(cache_saved_time_.load(std::memory_order_relaxed));
+        status.values.push_back(key_value);
+    }
+
+    if (received == 0) {
+        status.level = diagnostic_msgs::DiagnosticStatus::STALE;
+        status.message = "No boundaries received";
+    } else if (dropped > 0) {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message = "Dropping input messages";
+    } else {
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.message = "OK";
+    }
+    return status;
+}
+
+} // namespace min_curv_ros_wrapper
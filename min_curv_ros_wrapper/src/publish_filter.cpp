@@ -0,0 +1,93 @@
+#include "min_curv_ros_wrapper/publish_filter.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace min_curv_ros_wrapper {
+
+PublishFilter::PublishFilter(const double max_deviation, const double max_curvature_change, const double keep_alive)
+    : max_deviation_(max_deviation), max_curvature_change_(max_curvature_change), keep_alive_(keep_alive) {}
+
+const bool PublishFilter::accept(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature) {
+    const auto now = std::chrono::steady_clock::now();
+    last_change_ = compare(points, curvature);
+    const bool changed = published_points_.size() < 2 ||
+                         last_change_.deviation > max_deviation_ ||
+                         last_change_.curvature_change > max_curvature_change_ ||
+                         last_change_.length_change > max_deviation_;
+    const bool keep_alive_due = keep_alive_.count() > 0.0 && now - published_time_ >= keep_alive_;
+    if (!changed && !keep_alive_due) {
+        ++suppressed_;
+        return false;
+    }
+    published_points_ = points;
+    published_curvature_ = curvature;
+    published_time_ = now;
+    ++accepted_;
+    return true;
+}
+
+const PublishFilter::Change PublishFilter::compare(const std::vector<Eigen::Vector2d>& points,
+                                                   const std::vector<double>& curvature) const {
+    if (published_points_.size() < 2 || points.size() < 2 || curvature.size() != points.size() ||
+        published_curvature_.size() != published_points_.size()) {
+        return Change();
+    }
+    // Either way round, so that a path that only covers part of the other one is not missed
+    Change change = directedChange(points, curvature, published_points_, published_curvature_);
+    const Change reverse = directedChange(published_points_, published_curvature_, points, curvature);
+    change.deviation = std::max(change.deviation, reverse.deviation);
+    change.curvature_change = std::max(change.curvature_change, reverse.curvature_change);
+    change.length_change = std::abs(length(points) - length(published_points_));
+    return change;
+}
+
+const PublishFilter::Change PublishFilter::directedChange(const std::vector<Eigen::Vector2d>& points,
+                                                          const std::vector<double>& curvature,
+                                                          const std::vector<Eigen::Vector2d>& reference_points,
+                                                          const std::vector<double>& reference_curvature) {
+    Change change;
+    // Brute force over all segments, the paths only have about a hundred samples. Samples past the
+    // ends of the reference path are measured to its end points, so a horizon that moved on counts.
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        double min_distance = std::numeric_limits<double>::infinity();
+        double nearest_curvature = reference_curvature.front();
+        for (std::size_t j = 0; j + 1 < reference_points.size(); ++j) {
+            const Eigen::Vector2d segment = reference_points[j + 1] - reference_points[j];
+            const double squared_length = segment.squaredNorm();
+            const double t = squared_length > 0.0 ?
+                std::min(1.0, std::max(0.0, (points[i] - reference_points[j]).dot(segment) / squared_length)) : 0.0;
+            const double distance = (reference_points[j] + t * segment - points[i]).norm();
+            if (distance < min_distance) {
+                min_distance = distance;
+                nearest_curvature = (1.0 - t) * reference_curvature[j] + t * reference_curvature[j + 1];
+            }
+        }
+        change.deviation = std::max(change.deviation, min_distance);
+        change.curvature_change = std::max(change.curvature_change, std::abs(curvature[i] - nearest_curvature));
+    }
+    return change;
+}
+
+const double PublishFilter::length(const std::vector<Eigen::Vector2d>& points) {
+    double length = 0.0;
+    for (std::size_t i = 0; i + 1 < points.size(); ++i) {
+        length += (points[i + 1] - points[i]).norm();
+    }
+    return length;
+}
+
+const PublishFilter::Change& PublishFilter::getLastChange() const {
+    return last_change_;
+}
+
+const std::size_t PublishFilter::getAccepted() const {
+    return accepted_;
+}
+
+const std::size_t PublishFilter::getSuppressed() const {
+    return suppressed_;
+}
+
+} // namespace min_curv_ros_wrapper
@@ -0,0 +1,64 @@
+#include "min_curv_ros_wrapper/realtime.hpp"
+
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace min_curv_ros_wrapper {
+
+void lockMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        throw std::runtime_error(std::string("Could not lock the process memory: ") + std::strerror(errno));
+    }
+    // Trimmed or unmapped heap would be faulted in again on the next allocation of the same size
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+}
+
+void configureThread(const std::vector<int>& cpus, const int priority) {
+    if (!cpus.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (const int cpu : cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                throw std::runtime_error("Invalid core " + std::to_string(cpu) + " for the optimizer thread.");
+            }
+            CPU_SET(cpu, &cpu_set);
+        }
+        const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (error != 0) {
+            throw std::runtime_error(std::string("Could not pin the optimizer thread: ") + std::strerror(error));
+        }
+    }
+    if (priority > 0) {
+        sched_param param{};
+        param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            throw std::runtime_error(std::string("Could not set SCHED_FIFO for the optimizer thread: ") + std::strerror(error));
+        }
+    }
+}
+
+void ThreadActivityMonitor::start() {
+    getrusage(RUSAGE_THREAD, &start_usage_);
+    start_cpu_ = sched_getcpu();
+}
+
+const ThreadActivity ThreadActivityMonitor::stop() const {
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    ThreadActivity activity;
+    activity.page_faults = (usage.ru_minflt - start_usage_.ru_minflt) + (usage.ru_majflt - start_usage_.ru_majflt);
+    activity.preemptions = usage.ru_nivcsw - start_usage_.ru_nivcsw;
+    activity.migrated = start_cpu_ >= 0 && sched_getcpu() != start_cpu_;
+    return activity;
+}
+
+} // namespace min_curv_ros_wrapper
@@ -1,23 +1,66 @@
 #include "min_curv_ros_wrapper/ros_wrapper.hpp"
 
+#include <cmath>
+#include <algorithm>
+
 namespace min_curv_ros_wrapper {
 
-RosWrapper::RosWrapper(ros::NodeHandle& nh) : nh_(nh) {
+namespace {
+
+// Curvature magnitudes with the sign of the turn of the sampled path, positive to the left like in
+// spline::TrajectorySnapshot. Each point takes the turn of its neighbours, the end points that of the next one.
+std::vector<double> signedCurvature(const std::vector<Eigen::Vector2d>& points, const std::vector<double>& curvature) {
+    std::vector<double> result(curvature);
+    if (points.size() < 3) {
+        return result;
+    }
+    for (std::size_t i = 0; i < std::min(points.size(), result.size()); ++i) {
+        const std::size_t center = std::clamp<std::size_t>(i, 1, points.size() - 2);
+        const Eigen::Vector2d incoming = points[center] - points[center - 1];
+        const Eigen::Vector2d outgoing = points[center + 1] - points[center];
+        const double turn = incoming.x() * outgoing.y() - incoming.y() * outgoing.x();
+        result[i] = turn < 0.0 ? -std::abs(result[i]) : std::abs(result[i]);
+    }
+    return result;
+}
+
+} // namespace
+
+RosWrapper::RosWrapper(ros::NodeHandle& nh) : nh_(nh), diagnostics_("min_curv_ros_wrapper") {
     initialize();
     subscribeAndAdvertise();
 }
 
+RosWrapper::~RosWrapper() {
+    // A disabled queue drops its callbacks and ends the optimizer thread at the next wait
+    if (optimizer_thread_.joinable()) {
+        optimizer_queue_.disable();
+        optimizer_thread_.join();
+    }
+}
+
 void RosWrapper::initialize() {
     // Topics
     nh_.param<std::string>("topics/boundaries", topics_.boundaries, "/initial/boundaries");
+    nh_.param<std::string>("topics/corridor_widths", topics_.corridor_widths, "/initial/corridor_widths");
+    nh_.param<std::string>("topics/occupancy_grid", topics_.occupancy_grid, "/map");
     nh_.param<std::string>("topics/optimized_path", topics_.optimized_path, "/optimized/centerline");
     nh_.param<std::string>("topics/initial_curvature", topics_.initial_curvature, "/initial/curvature");
     nh_.param<std::string>("topics/optimized_curvature", topics_.optimized_curvature, "/optimized/curvature");
+    nh_.param<std::string>("topics/optimized_spline", topics_.optimized_spline, "/optimized/spline");
+    nh_.param<std::string>("topics/near_horizon_path", topics_.near_horizon_path, "/optimized/near_horizon/centerline");
+    nh_.param<std::string>("topics/near_horizon_curvature", topics_.near_horizon_curvature, "/optimized/near_horizon/curvature");
     nh_.param<std::string>("topics/left_boundary", topics_.left_boundary, "/optimized/left_boundary");
     nh_.param<std::string>("topics/right_boundary", topics_.right_boundary, "/optimized/right_boundary");
+    nh_.param<std::string>("topics/optimize_corridor", topics_.optimize_corridor, "/optimize_corridor");
+    nh_.param<std::string>("topics/diagnostics", topics_.diagnostics, "/diagnostics");
+    nh_.param<double>("diagnostics/rate", diagnostics_rate_, 1.0);
+    int diagnostics_window;
+    nh_.param<int>("diagnostics/window", diagnostics_window, 10);
+    diagnostics_.setWindowSize(static_cast<std::size_t>(std::max(1, diagnostics_window)));
 
     // Optimizer parameters
-    int num_control_points, max_num_iterations, num_points_evaluate, num_nearest, kd_tree_leafs;
+    int num_control_points, max_num_iterations, num_points_evaluate, num_nearest, kd_tree_leafs, cache_size;
     std::unique_ptr<spline::optimization::MinCurvatureParams> params = std::make_unique<spline::optimization::MinCurvatureParams>();
     nh_.param<bool>("optimizer/verbose", params->verbose, false);
     nh_.param<bool>("optimizer/constant_system_matrix", params->constant_system_matrix, false);
@@ -30,38 +73,303 @@ void RosWrapper::initialize() {
     nh_.param<int>("optimizer/num_nearest", num_nearest, 3);
     nh_.param<double>("optimizer/shrink", params->shrink, 0.3);
     nh_.param<int>("optimizer/kd_tree_leafs", kd_tree_leafs, 10);
+    nh_.param<bool>("optimizer/cache/enabled", params->use_cache, false);
+    nh_.param<int>("optimizer/cache/size", cache_size, 64);
+    nh_.param<double>("optimizer/cache/quantization", params->cache_quantization, 0.01);
     params->num_points_evaluate = static_cast<std::size_t>(num_points_evaluate);
     params->num_nearest = static_cast<std::size_t>(num_nearest);
     params->num_control_points = static_cast<std::size_t>(num_control_points);
     params->max_num_iterations = static_cast<std::size_t>(max_num_iterations);
     params->kdtree_leafs = static_cast<std::size_t>(kd_tree_leafs);
+    params->cache_size = static_cast<std::size_t>(cache_size);
+    std::string formulation;
+    nh_.param<std::string>("optimizer/formulation", formulation, "dense");
+    if (formulation == "sparse") {
+        params->formulation = spline::optimization::QPFormulation::SparseSpline;
+    } else if (formulation == "discrete") {
+        params->formulation = spline::optimization::QPFormulation::DiscreteCurvature;
+    } else if (formulation != "dense") {
+        ROS_WARN("[min_curv_ros_wrapper] Unknown formulation '%s', using the dense one.", formulation.c_str());
+    }
+    nh_.param<bool>("optimizer/unconstrained_fast_path", params->unconstrained_fast_path, false);
+    int checkpoint_interval;
+    nh_.param<std::string>("optimizer/checkpoint/file", params->checkpoint_file, "");
+    nh_.param<int>("optimizer/checkpoint/interval", checkpoint_interval, 100);
+    nh_.param<bool>("optimizer/reuse_solution", params->reuse_solution, false);
+    params->checkpoint_interval = static_cast<std::size_t>(checkpoint_interval);
+    nh_.param<bool>("optimizer/adaptive_placement/enabled", optimizer_params_.adaptive_placement, false);
+    nh_.param<double>("optimizer/adaptive_placement/curvature_gain", optimizer_params_.curvature_gain, 10.0);
+    optimizer_params_.num_control_points = params->num_control_points;
+    int progressive_num_control_points;
+    nh_.param<bool>("progressive/enabled", progressive_params_.enabled, false);
+    nh_.param<int>("progressive/num_control_points", progressive_num_control_points, 6);
+    progressive_params_.num_control_points = static_cast<std::size_t>(std::max(3, progressive_num_control_points));
+    int warmup_solves;
+    nh_.param<bool>("realtime/enabled", realtime_params_.enabled, false);
+    nh_.param<bool>("realtime/lock_memory", realtime_params_.lock_memory, true);
+    nh_.param<std::vector<int>>("realtime/cpus", realtime_params_.cpus, std::vector<int>());
+    nh_.param<int>("realtime/priority", realtime_params_.priority, 0);
+    nh_.param<int>("realtime/warmup_solves", warmup_solves, 5);
+    realtime_params_.priority = std::max(0, realtime_params_.priority);
+    realtime_params_.warmup_solves = static_cast<std::size_t>(std::max(0, warmup_solves));
+
+    // Corridor mode
+    std::string corridor_mode;
+    nh_.param<std::string>("corridor/mode", corridor_mode, "nearest_neighbors");
+    nh_.param<bool>("corridor/use_occupancy_grid", corridor_params_.use_occupancy_grid, false);
+    nh_.param<double>("corridor/resolution", corridor_params_.resolution, 0.1);
+    nh_.param<double>("corridor/margin", corridor_params_.margin, 5.0);
+    nh_.param<double>("corridor/max_width", params->max_corridor_width, 20.0);
+    corridor_params_.distance_field = corridor_mode == "distance_field";
+    if (!corridor_params_.distance_field && corridor_mode != "nearest_neighbors") {
+        ROS_WARN("[min_curv_ros_wrapper] Unknown corridor mode %s, using nearest_neighbors.", corridor_mode.c_str());
+    }
+
+    // Raceline mode
+    bool raceline_enabled;
+    std::string raceline_file, track_map_file;
+    std::unique_ptr<spline::optimization::RacelineParams> raceline_params = std::make_unique<spline::optimization::RacelineParams>();
+    nh_.param<bool>("raceline/enabled", raceline_enabled, false);
+    nh_.param<std::string>("raceline/file", raceline_file, "");
+    nh_.param<std::string>("raceline/map_file", track_map_file, "");
+    nh_.param<bool>("raceline/closed", raceline_params->closed, true);
+    nh_.param<double>("raceline/max_deviation", raceline_params->max_deviation, 0.5);
+    raceline_params->kdtree_leafs = static_cast<std::size_t>(kd_tree_leafs);
+    // Precomputed system matrix inverse of the track map, replaces the factorization at startup
+    Eigen::MatrixXd system_inverse;
+    if (raceline_enabled) {
+        raceline_ = std::make_unique<spline::optimization::Raceline>(std::move(raceline_params));
+        try {
+            if (!track_map_file.empty()) {
+                const spline::optimization::TrackMap track_map(track_map_file);
+                raceline_->setRaceline(track_map);
+                const double* inverse = track_map.getSystemInverse(params->num_control_points);
+                if (inverse != nullptr) {
+                    const Eigen::Index size = 4 * static_cast<Eigen::Index>(params->num_control_points);
+                    system_inverse = Eigen::Map<const Eigen::MatrixXd>(inverse, size, size);
+                }
+                ROS_INFO("[min_curv_ros_wrapper] Mapped track with %zu samples from %s.", raceline_->size(), track_map_file.c_str());
+            } else {
+                raceline_->load(raceline_file);
+                ROS_INFO("[min_curv_ros_wrapper] Loaded raceline with %zu samples from %s.", raceline_->size(), raceline_file.c_str());
+            }
+        } catch (const std::exception& e) {
+            ROS_ERROR("[min_curv_ros_wrapper] %s. Falling back to the live optimization.", e.what());
+            raceline_.reset();
+        }
+    }
 
     // Frames
     nh_.param<std::string>("frames/robot", frames_.robot, "base_link");
     nh_.param<std::string>("frames/world", frames_.world, "map");
 
+    // Batch optimizer parameters
+    int batch_num_threads, batch_max_size;
+    std::unique_ptr<spline::optimization::BatchOptimizerParams> batch_params = std::make_unique<spline::optimization::BatchOptimizerParams>();
+    nh_.param<int>("batch/num_threads", batch_num_threads, 4);
+    nh_.param<int>("batch/max_size", batch_max_size, 16);
+    nh_.param<double>("batch/window", batch_params->batch_window, 5.0);
+    batch_params->num_threads = static_cast<std::size_t>(batch_num_threads);
+    batch_params->max_batch_size = static_cast<std::size_t>(batch_max_size);
+    batch_params->optimizer = *params;
+    batch_optimizer_ = std::make_unique<spline::optimization::BatchOptimizer>(std::move(batch_params));
+
+    // Near-horizon optimizer of the progressive mode
+    if (progressive_params_.enabled) {
+        auto near_params = std::make_unique<spline::optimization::MinCurvatureParams>(*params);
+        near_params->num_control_points = progressive_params_.num_control_points;
+        near_params->checkpoint_file.clear();
+        near_optimizer_ = std::make_unique<spline::optimization::MinCurvatureOptimizer>(std::move(near_params));
+    }
+
     // Initialize the optimizer
-    optimizer_ = std::make_unique<spline::optimization::MinCurvatureOptimizer>(std::move(params));
+    if (system_inverse.size() > 0 && params->constant_system_matrix &&
+        params->formulation == spline::optimization::QPFormulation::DenseSpline) {
+        optimizer_ = std::make_unique<spline::optimization::MinCurvatureOptimizer>(std::move(params), system_inverse);
+    } else {
+        optimizer_ = std::make_unique<spline::optimization::MinCurvatureOptimizer>(std::move(params));
+    }
+
+    bool publish_filter_enabled;
+    double max_deviation, max_curvature_change, keep_alive;
+    nh_.param<bool>("publish_filter/enabled", publish_filter_enabled, false);
+    nh_.param<double>("publish_filter/max_deviation", max_deviation, 0.02);
+    nh_.param<double>("publish_filter/max_curvature_change", max_curvature_change, 0.03);
+    nh_.param<double>("publish_filter/keep_alive", keep_alive, 1.0);
+    if (publish_filter_enabled) {
+        publish_filter_ = std::make_unique<PublishFilter>(max_deviation, max_curvature_change, keep_alive);
+        // The near-horizon windows are only compared with each other
+        if (progressive_params_.enabled) {
+            near_publish_filter_ = std::make_unique<PublishFilter>(max_deviation, max_curvature_change, keep_alive);
+        }
+    }
+
+    int trajectory_samples;
+    nh_.param<int>("trajectory_buffer/num_samples", trajectory_samples, 200);
+    trajectory_buffer_ = std::make_shared<spline::TrajectoryBuffer>(static_cast<std::size_t>(trajectory_samples));
+
+    std::string shared_memory_name;
+    int shared_memory_slots, shared_memory_max_points;
+    nh_.param<std::string>("shared_memory/name", shared_memory_name, "");
+    nh_.param<int>("shared_memory/slots", shared_memory_slots, 8);
+    nh_.param<int>("shared_memory/max_points", shared_memory_max_points, 512);
+    if (!shared_memory_name.empty()) {
+        try {
+            trajectory_ring_ = std::make_unique<spline::TrajectoryRingWriter>(shared_memory_name,
+                                                                              static_cast<std::size_t>(shared_memory_slots),
+                                                                              static_cast<std::size_t>(shared_memory_max_points));
+            ROS_INFO("[min_curv_ros_wrapper] Writing trajectories to shared memory segment %s.", shared_memory_name.c_str());
+        } catch (const std::exception& e) {
+            ROS_ERROR("[min_curv_ros_wrapper] %s. Shared memory output disabled.", e.what());
+        }
+    }
 
     // Initialize the splines
     centerline_spline_ = std::make_shared<spline::ParametricCubicSpline>();
     left_boundary_spline_ = std::make_shared<spline::ParametricCubicSpline>();
     right_boundary_spline_ = std::make_shared<spline::ParametricCubicSpline>();
     optimized_trajectory_ = std::make_shared<spline::ParametricCubicSpline>();
+    near_centerline_spline_ = std::make_shared<spline::ParametricCubicSpline>();
 
     optimizer_->setSplines(centerline_spline_, left_boundary_spline_, right_boundary_spline_);
 }
 
 void RosWrapper::subscribeAndAdvertise() {
-    // Initialize the subscriber using the parameter
-    boundaries_sub_ = nh_.subscribe(topics_.boundaries, 1, &RosWrapper::boundariesCallback, this);
+    // Initialize the subscriber using the parameter, in real-time mode the corridors go to the optimizer thread
+    optimizer_nh_ = nh_;
+    if (realtime_params_.enabled) {
+        optimizer_nh_.setCallbackQueue(&optimizer_queue_);
+    }
+    boundaries_sub_ = optimizer_nh_.subscribe(topics_.boundaries, 1, &RosWrapper::boundariesCallback, this);
+    corridor_widths_sub_ = optimizer_nh_.subscribe(topics_.corridor_widths, 1, &RosWrapper::corridorWidthsCallback, this);
+    if (corridor_params_.distance_field && corridor_params_.use_occupancy_grid) {
+        occupancy_grid_sub_ = nh_.subscribe(topics_.occupancy_grid, 1, &RosWrapper::occupancyGridCallback, this);
+    }
 
     // Initialize publishers using the parameters
     pub_.optimized_path = nh_.advertise<nav_msgs::Path>(topics_.optimized_path, 1);
     pub_.initial_curvature = nh_.advertise<std_msgs::Float64>(topics_.initial_curvature, 1);
     pub_.optimized_curvature = nh_.advertise<std_msgs::Float64>(topics_.optimized_curvature, 1);
+    pub_.optimized_spline = nh_.advertise<min_curv_msgs::BSplineTrajectory>(topics_.optimized_spline, 1);
     pub_.left_boundary = nh_.advertise<nav_msgs::Path>(topics_.left_boundary, 1);
     pub_.right_boundary = nh_.advertise<nav_msgs::Path>(topics_.right_boundary, 1);
+    if (progressive_params_.enabled) {
+        pub_.near_horizon_path = nh_.advertise<nav_msgs::Path>(topics_.near_horizon_path, 1);
+        pub_.near_horizon_curvature = nh_.advertise<std_msgs::Float64MultiArray>(topics_.near_horizon_curvature, 1);
+    }
+
+    // Advertise the on-demand optimization service
+    optimize_corridor_srv_ = nh_.advertiseService(topics_.optimize_corridor, &RosWrapper::optimizeCorridorCallback, this);
+
+    // Periodic latency and throughput report
+    if (diagnostics_rate_ > 0.0) {
+        pub_.diagnostics = nh_.advertise<diagnostic_msgs::DiagnosticArray>(topics_.diagnostics, 1);
+        diagnostics_timer_ = nh_.createTimer(ros::Duration(1.0 / diagnostics_rate_), &RosWrapper::diagnosticsCallback, this);
+    }
+
+    // Corridors that arrive during the warm-up wait in the queue, only the latest one is kept
+    if (realtime_params_.enabled) {
+        optimizer_thread_ = std::thread(&RosWrapper::optimizerThread, this);
+    }
+}
+
+void RosWrapper::optimizerThread() {
+    if (realtime_params_.lock_memory) {
+        try {
+            lockMemory();
+        } catch (const std::exception& e) {
+            ROS_WARN("[min_curv_ros_wrapper] %s. Solves may still be delayed by page faults.", e.what());
+        }
+    }
+    try {
+        configureThread(realtime_params_.cpus, realtime_params_.priority);
+    } catch (const std::exception& e) {
+        ROS_WARN("[min_curv_ros_wrapper] %s. The optimizer thread keeps the default scheduling.", e.what());
+    }
+    warmUp();
+    ROS_INFO("[min_curv_ros_wrapper] Real-time optimizer thread ready after %zu warm-up solves.", realtime_params_.warmup_solves);
+
+    while (nh_.ok() && optimizer_queue_.isEnabled()) {
+        optimizer_queue_.callAvailable(ros::WallDuration(0.1));
+    }
+}
+
+void RosWrapper::warmUp() {
+    // 4 m wide arc with the number of control points the inputs are resampled to, nothing is published
+    const std::size_t num_points = optimizer_params_.num_control_points > 0 ? optimizer_params_.num_control_points : 20;
+    std::vector<Eigen::Vector2d> centerline(num_points);
+    std::vector<Eigen::Vector2d> left_boundary(num_points);
+    std::vector<Eigen::Vector2d> right_boundary(num_points);
+    for (std::size_t i = 0; i < num_points; ++i) {
+        // 2 m spacing on a 50 m radius
+        const double angle = 2.0 * i / 50.0;
+        const Eigen::Vector2d normal(-std::sin(angle), std::cos(angle));
+        centerline[i] = 50.0 * Eigen::Vector2d(std::sin(angle), 1.0 - std::cos(angle));
+        left_boundary[i] = centerline[i] + 2.0 * normal;
+        right_boundary[i] = centerline[i] - 2.0 * normal;
+    }
+    left_boundary_spline_->setControlPoints(left_boundary);
+    right_boundary_spline_->setControlPoints(right_boundary);
+    centerline_spline_->setControlPoints(centerline);
+    const std::size_t num_near = std::min(num_points, progressive_params_.num_control_points);
+    near_centerline_spline_->setControlPoints(std::vector<Eigen::Vector2d>(centerline.begin(), centerline.begin() + num_near));
+    std::vector<std::pair<spline::optimization::MinCurvatureOptimizer*, std::shared_ptr<spline::BaseCubicSpline>>> optimizers = {
+        {optimizer_.get(), centerline_spline_}};
+    if (near_optimizer_ && num_points > progressive_params_.num_control_points) {
+        optimizers.emplace_back(near_optimizer_.get(), near_centerline_spline_);
+    }
+    // The synthetic corridor must not end up in the cache, a checkpoint or the warm start of the first input
+    for (const auto& optimizer : optimizers) {
+        optimizer.first->setFixedDisplacements(Eigen::MatrixXd());
+        optimizer.first->setWarmUp(true);
+    }
+
+    // Every corridor the inputs can select: the boundaries callback's mode, then the corridor widths
+    std::shared_ptr<const spline::optimization::DistanceField> distance_field;
+    if (corridor_params_.distance_field) {
+        try {
+            distance_field = std::make_shared<const spline::optimization::DistanceField>(
+                spline::optimization::DistanceField::fromBoundaries(left_boundary, right_boundary,
+                                                                    corridor_params_.resolution, corridor_params_.margin));
+        } catch (const std::exception& e) {
+            ROS_WARN("[min_curv_ros_wrapper] Warm-up distance field failed: %s", e.what());
+        }
+    }
+    const Eigen::MatrixXd widths = Eigen::MatrixXd::Constant(num_points, 2, 2.0);
+    std::shared_ptr<spline::BaseCubicSpline> trajectory = std::make_shared<spline::ParametricCubicSpline>();
+    for (const bool corridor_widths : {false, true}) {
+        try {
+            for (const auto& optimizer : optimizers) {
+                if (corridor_widths) {
+                    optimizer.first->setCorridor(optimizer.second, widths.topRows(optimizer.second->size()));
+                } else if (distance_field) {
+                    optimizer.first->setDistanceField(optimizer.second, distance_field);
+                } else {
+                    optimizer.first->setSplines(optimizer.second, left_boundary_spline_, right_boundary_spline_);
+                }
+            }
+            for (std::size_t i = 0; i < realtime_params_.warmup_solves; ++i) {
+                for (const auto& optimizer : optimizers) {
+                    optimizer.first->setUp(optimizer_params_.last_point_shrink);
+                    optimizer.first->solve(trajectory, optimizer_params_.weight);
+                    optimizer.first->setUp(optimizer_params_.last_point_shrink);
+                    optimizer.first->solve(trajectory, 1 - optimizer_params_.weight);
+                }
+                const spline::CubicBSpline sampled(trajectory->getControlPoints());
+                for (double u = 0.0; u <= 1.0; u += 0.01) {
+                    sampled.evaluateSpline(u, 0);
+                    sampled.computeCurvature(u);
+                }
+            }
+        } catch (const std::exception& e) {
+            ROS_WARN("[min_curv_ros_wrapper] Warm-up solve failed: %s", e.what());
+        }
+    }
+    // Back to the boundary splines the optimizers start with
+    for (const auto& optimizer : optimizers) {
+        optimizer.first->setSplines(optimizer.second, left_boundary_spline_, right_boundary_spline_);
+        optimizer.first->setWarmUp(false);
+    }
 }
 
 // Callback function to process the boundaries and centerline
@@ -69,6 +377,10 @@ void RosWrapper::boundariesCallback(const min_curv_msgs::Paths::ConstPtr& msg) {
     assert (msg->left_boundary.poses.size() == msg->right_boundary.poses.size() &&
             msg->left_boundary.poses.size() == msg->centerline.poses.size());
 
+    // The corridor callbacks share the optimizer, the splines and the single-writer trajectory buffer
+    std::lock_guard<std::mutex> corridor_lock(corridor_mutex_);
+    const ros::WallTime callback_start = ros::WallTime::now();
+    diagnostics_.recordInput(NodeDiagnostics::Boundaries, msg->header.seq);
     boundaries_time_ = msg->header.stamp;
     // Extract the boundaries and centerline points from the message
     std::vector<Eigen::Vector2d> left_boundary;
@@ -88,10 +400,213 @@ void RosWrapper::boundariesCallback(const min_curv_msgs::Paths::ConstPtr& msg) {
     // Set the splines for left, right, and centerline
     left_boundary_spline_->setControlPoints(left_boundary);
     right_boundary_spline_->setControlPoints(right_boundary);
+    std::shared_ptr<const spline::optimization::DistanceField> distance_field;
+    if (corridor_params_.distance_field && corridor_params_.use_occupancy_grid) {
+        std::lock_guard<std::mutex> lock(occupancy_field_mutex_);
+        distance_field = occupancy_field_;
+        if (!distance_field) {
+            ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] No occupancy grid received yet, using the nearest boundary points.");
+        }
+    } else if (corridor_params_.distance_field) {
+        try {
+            distance_field = std::make_shared<const spline::optimization::DistanceField>(
+                spline::optimization::DistanceField::fromBoundaries(left_boundary, right_boundary,
+                                                                    corridor_params_.resolution, corridor_params_.margin));
+        } catch (const std::exception& e) {
+            ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] %s", e.what());
+        }
+    }
+    if (distance_field) {
+        optimizer_->setDistanceField(centerline_spline_, distance_field);
+    } else {
+        optimizer_->setSplines(centerline_spline_, left_boundary_spline_, right_boundary_spline_);
+    }
+    // The near horizon searches the same boundaries or field, only its reference is shorter
+    if (near_optimizer_ && distance_field) {
+        near_optimizer_->setDistanceField(near_centerline_spline_, distance_field);
+    } else if (near_optimizer_) {
+        near_optimizer_->setSplines(near_centerline_spline_, left_boundary_spline_, right_boundary_spline_);
+    }
+    if (optimizer_params_.adaptive_placement) {
+        // Dense in corners and sparse on straights, the optimizer supports the resulting non-uniform knots
+        const spline::ParametricCubicSpline input_centerline(centerline);
+        const std::size_t num_control_points = optimizer_params_.num_control_points > 0 ? optimizer_params_.num_control_points : centerline.size();
+        const auto placement = spline::placeControlPoints(input_centerline, num_control_points,
+                                                          optimizer_params_.curvature_gain,
+                                                          std::max<std::size_t>(200, 4 * centerline.size()));
+        centerline_spline_->setControlPoints(placement.control_points, placement.knots);
+    } else {
+        centerline_spline_->setControlPoints(centerline);
+    }
+
+    diagnostics_.recordStage(NodeDiagnostics::Preprocessing, (ros::WallTime::now() - callback_start).toSec());
+
+    // On a known track publish the precomputed raceline unless the corridor deviates from the map
+    if (!raceline_ || !publishRacelineWindow(centerline)) {
+        // Call the trajectory optimization function
+        optimizeTrajectory();
+    }
+    diagnostics_.recordStage(NodeDiagnostics::Callback, (ros::WallTime::now() - callback_start).toSec());
+}
+
+std::shared_ptr<const spline::TrajectoryBuffer> RosWrapper::getTrajectoryBuffer() const {
+    return trajectory_buffer_;
+}
+
+void RosWrapper::publishSnapshot(const spline::BaseCubicSpline& trajectory) {
+    if (!trajectory_buffer_->publish(trajectory, boundaries_time_.toSec())) {
+        ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] Trajectory buffer readers hold every spare slot, dropped %lu snapshots so far.",
+                          static_cast<unsigned long>(trajectory_buffer_->dropped()));
+    }
+}
+
+// Publish the latency and throughput statistics collected since the last report
+void RosWrapper::diagnosticsCallback(const ros::TimerEvent& event) {
+    diagnostic_msgs::DiagnosticArray array;
+    array.header.stamp = ros::Time::now();
+    // The first event has no previous one, assume the nominal period
+    const double period = event.last_real.isZero() ? 1.0 / diagnostics_rate_ : (event.current_real - event.last_real).toSec();
+    array.status.push_back(diagnostics_.collect(period));
+    pub_.diagnostics.publish(array);
+}
+
+// Callback function to turn an occupancy grid into the distance field of the following corridors
+void RosWrapper::occupancyGridCallback(const nav_msgs::OccupancyGrid::ConstPtr& msg) {
+    const auto& orientation = msg->info.origin.orientation;
+    if (std::abs(orientation.x) + std::abs(orientation.y) + std::abs(orientation.z) > 1e-6) {
+        ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] Occupancy grids must be axis aligned, ignoring the grid.");
+        return;
+    }
+    try {
+        const std::vector<std::int8_t> occupancy(msg->data.begin(), msg->data.end());
+        auto field = std::make_shared<const spline::optimization::DistanceField>(
+            occupancy, msg->info.width, msg->info.height, msg->info.resolution,
+            Eigen::Vector2d(msg->info.origin.position.x, msg->info.origin.position.y));
+        std::lock_guard<std::mutex> lock(occupancy_field_mutex_);
+        occupancy_field_ = std::move(field);
+    } catch (const std::exception& e) {
+        ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] %s", e.what());
+    }
+}
+
+// Callback function to process a corridor given by centerline and widths
+void RosWrapper::corridorWidthsCallback(const min_curv_msgs::CorridorWidths::ConstPtr& msg) {
+    const std::size_t num_points = msg->x.size();
+    if (num_points < 3 || msg->y.size() != num_points || msg->left_width.size() != num_points ||
+        msg->right_width.size() != num_points) {
+        ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] Corridor widths message needs x, y and widths of equal size.");
+        return;
+    }
+    std::lock_guard<std::mutex> corridor_lock(corridor_mutex_);
+    const ros::WallTime callback_start = ros::WallTime::now();
+    diagnostics_.recordInput(NodeDiagnostics::CorridorWidths, msg->header.seq);
+    boundaries_time_ = msg->header.stamp;
+
+    std::vector<Eigen::Vector2d> centerline(num_points);
+    Eigen::MatrixXd widths(num_points, 2);
+    for (std::size_t i = 0; i < num_points; ++i) {
+        centerline[i] = Eigen::Vector2d(msg->x[i], msg->y[i]);
+        widths(i, 0) = msg->left_width[i];
+        widths(i, 1) = msg->right_width[i];
+    }
     centerline_spline_->setControlPoints(centerline);
 
-    // Call the trajectory optimization function
+    // Boundaries are only rebuilt for publishing, the optimizer uses the widths directly
+    const auto coefficients = centerline_spline_->getCoefficients();
+    std::vector<Eigen::Vector2d> left_boundary(num_points);
+    std::vector<Eigen::Vector2d> right_boundary(num_points);
+    for (std::size_t i = 0; i < num_points; ++i) {
+        const Eigen::Vector2d normal = Eigen::Vector2d(-coefficients.second(1, i), coefficients.first(1, i)).normalized();
+        left_boundary[i] = centerline[i] + widths(i, 0) * normal;
+        right_boundary[i] = centerline[i] - widths(i, 1) * normal;
+    }
+    left_boundary_spline_->setControlPoints(left_boundary);
+    right_boundary_spline_->setControlPoints(right_boundary);
+    try {
+        optimizer_->setCorridor(centerline_spline_, widths);
+        if (near_optimizer_) {
+            near_optimizer_->setCorridor(near_centerline_spline_,
+                                         widths.topRows(std::min(progressive_params_.num_control_points, num_points)));
+        }
+    } catch (const std::invalid_argument& e) {
+        ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] %s", e.what());
+        return;
+    }
+    diagnostics_.recordStage(NodeDiagnostics::Preprocessing, (ros::WallTime::now() - callback_start).toSec());
+
     optimizeTrajectory();
+    diagnostics_.recordStage(NodeDiagnostics::Callback, (ros::WallTime::now() - callback_start).toSec());
+}
+
+// Publish the slice of the precomputed raceline matching the current corridor
+const bool RosWrapper::publishRacelineWindow(const std::vector<Eigen::Vector2d>& centerline) {
+    spline::optimization::RacelineWindow window;
+    if (!raceline_->getWindow(centerline, window)) {
+        ROS_WARN_THROTTLE(1.0, "[min_curv_ros_wrapper] %s, solving the QP.", window.rejection.c_str());
+        return false;
+    }
+
+    const ros::WallTime sampling_start = ros::WallTime::now();
+    publishSnapshot(spline::ParametricCubicSpline(window.points));
+
+    std::vector<double> initial_curvatures;
+    std::vector<Eigen::Vector2d> left_boundary;
+    std::vector<Eigen::Vector2d> right_boundary;
+    for (double u = 0.0; u <= 1.0; u += 0.01) {
+        initial_curvatures.push_back(centerline_spline_->computeCurvature(u));
+        left_boundary.push_back(left_boundary_spline_->evaluateSpline(u, 0));
+        right_boundary.push_back(right_boundary_spline_->evaluateSpline(u, 0));
+    }
+    diagnostics_.recordStage(NodeDiagnostics::Sampling, (ros::WallTime::now() - sampling_start).toSec());
+
+    if (acceptTrajectory(window.points, window.curvature, false)) {
+        publish(window.points, left_boundary, right_boundary,
+                initial_curvatures, window.curvature);
+    }
+    return true;
+}
+
+// Service callback to optimize a corridor on demand
+bool RosWrapper::optimizeCorridorCallback(min_curv_msgs::OptimizeCorridor::Request& req,
+                                          min_curv_msgs::OptimizeCorridor::Response& res) {
+    spline::optimization::CorridorRequest request;
+    request.weight = optimizer_params_.weight;
+    request.last_point_shrink = optimizer_params_.last_point_shrink;
+    for (const auto& point : req.corridor.left_boundary.poses) {
+        request.left_boundary.emplace_back(point.pose.position.x, point.pose.position.y);
+    }
+    for (const auto& point : req.corridor.right_boundary.poses) {
+        request.right_boundary.emplace_back(point.pose.position.x, point.pose.position.y);
+    }
+    for (const auto& point : req.corridor.centerline.poses) {
+        request.centerline.emplace_back(point.pose.position.x, point.pose.position.y);
+    }
+
+    // Block until the batch containing this request has been solved
+    const auto result = batch_optimizer_->submit(request).get();
+    res.success = result.success;
+    res.message = result.message;
+    res.batch_size = static_cast<uint32_t>(result.batch_size);
+    res.queue_time = result.queue_time;
+    res.setup_time = result.setup_time;
+    res.solve_time = result.solve_time;
+    if (!result.success) {
+        ROS_WARN_STREAM("[min_curv_ros_wrapper] Corridor optimization failed: " << result.message);
+        return true;
+    }
+
+    const spline::CubicBSpline optimized_trajectory(result.control_points);
+    res.optimized_path.header.stamp = req.corridor.header.stamp;
+    res.optimized_path.header.frame_id = req.corridor.header.frame_id.empty() ? frames_.world : req.corridor.header.frame_id;
+    for (double u = 0.0; u <= 1.0; u += 0.01) {
+        const auto point = optimized_trajectory.evaluateSpline(u, 0);
+        geometry_msgs::PoseStamped pose;
+        pose.pose.position.x = point.x();
+        pose.pose.position.y = point.y();
+        res.optimized_path.poses.push_back(pose);
+        res.optimized_curvature.push_back(optimized_trajectory.computeCurvature(u));
+    }
+    return true;
 }
 
 // Function to optimize the trajectory using the minimum curvature optimization
@@ -102,6 +617,11 @@ void RosWrapper::optimizeTrajectory() {
         }
         return;
     }
+    // Progressive mode: the full horizon keeps the control points already published with the near horizon
+    optimizer_->setFixedDisplacements(near_optimizer_ ? publishNearHorizon() : Eigen::MatrixXd());
+    const ros::WallTime optimization_start = ros::WallTime::now();
+    ThreadActivityMonitor activity_monitor;
+    activity_monitor.start();
     // Set up the optimizer with the centerline, left, and right boundaries
     optimizer_->setUp(optimizer_params_.last_point_shrink);
     // First optimization with a specific weight
@@ -110,7 +630,28 @@ void RosWrapper::optimizeTrajectory() {
     optimizer_->setUp(optimizer_params_.last_point_shrink);
     optimizer_->solve(optimized_trajectory_, 1 - optimizer_params_.weight);
     optimized_trajectory_ = std::make_shared<spline::CubicBSpline>(optimized_trajectory_->getControlPoints());
+    publishSnapshot(*optimized_trajectory_);
+    const double optimization_time = (ros::WallTime::now() - optimization_start).toSec();
+    const auto activity = activity_monitor.stop();
+    diagnostics_.recordStage(NodeDiagnostics::Optimization, optimization_time);
+    diagnostics_.recordSolveActivity(activity.page_faults, activity.preemptions, activity.migrated);
+    ROS_DEBUG("[min_curv_ros_wrapper] Solve took %.3f ms with %lu page faults, %lu preemptions%s.",
+              1e3 * optimization_time, static_cast<unsigned long>(activity.page_faults),
+              static_cast<unsigned long>(activity.preemptions), activity.migrated ? " and a migration" : "");
+    const auto cache_stats = optimizer_->getCacheStats();
+    if (cache_stats.hits + cache_stats.misses > 0) {
+        diagnostics_.recordCacheStats(cache_stats.hits, cache_stats.misses, cache_stats.saved_time);
+        ROS_INFO_THROTTLE(10.0, "[min_curv_ros_wrapper] Solution cache hit rate: %.1f%%, saved %.1f ms in total.",
+                          100.0 * cache_stats.hitRate(), cache_stats.saved_time);
+    }
+    const auto& fast_path_stats = optimizer_->getFastPathStats();
+    if (fast_path_stats.hits + fast_path_stats.misses > 0) {
+        ROS_INFO_THROTTLE(10.0, "[min_curv_ros_wrapper] Unconstrained fast path hit rate: %.1f%% (%zu of %zu solves).",
+                          100.0 * fast_path_stats.hitRate(), fast_path_stats.hits,
+                          fast_path_stats.hits + fast_path_stats.misses);
+    }
     // Now we have the optimized trajectory, let's publish the result
+    const ros::WallTime sampling_start = ros::WallTime::now();
     std::vector<Eigen::Vector2d> opt_points;
     std::vector<double> initial_curvatures;
     std::vector<double> optimized_curvatures;
@@ -125,21 +666,59 @@ void RosWrapper::optimizeTrajectory() {
         left_boundary.push_back(left_boundary_spline_->evaluateSpline(u, 0));
         right_boundary.push_back(right_boundary_spline_->evaluateSpline(u, 0));
     }
+    diagnostics_.recordStage(NodeDiagnostics::Sampling, (ros::WallTime::now() - sampling_start).toSec());
 
     // Publish the optimized path and curvature
-    publish(opt_points, left_boundary, right_boundary, 
-                         initial_curvatures, optimized_curvatures);
+    if (acceptTrajectory(opt_points, optimized_curvatures, false)) {
+        publishSpline(optimized_trajectory_->getControlPoints(), false);
+        publish(opt_points, left_boundary, right_boundary,
+                initial_curvatures, optimized_curvatures);
+    }
 }
 
-// Function to publish the optimized path and curvatures
-void RosWrapper::publish(const std::vector<Eigen::Vector2d>& opt_points,
-                         const std::vector<Eigen::Vector2d>& left_boundary,
-                         const std::vector<Eigen::Vector2d>& right_boundary,
-                         const std::vector<double>& init_curv,
-                         const std::vector<double>& opt_curv) const {
-    // Publish the optimized path
+// Solve the first control points of the corridor on their own and publish them right away
+const Eigen::MatrixXd RosWrapper::publishNearHorizon() {
+    const ros::WallTime near_start = ros::WallTime::now();
+    const auto& control_points = centerline_spline_->getControlPoints();
+    const std::size_t num_near = progressive_params_.num_control_points;
+    if (control_points.size() <= num_near) {
+        return Eigen::MatrixXd();
+    }
+    near_centerline_spline_->setControlPoints(std::vector<Eigen::Vector2d>(control_points.begin(), control_points.begin() + num_near));
+    // Same two passes as the full horizon
+    std::shared_ptr<spline::BaseCubicSpline> near_trajectory = std::make_shared<spline::ParametricCubicSpline>();
+    near_optimizer_->setUp(optimizer_params_.last_point_shrink);
+    near_optimizer_->solve(near_trajectory, optimizer_params_.weight);
+    near_optimizer_->setUp(optimizer_params_.last_point_shrink);
+    near_optimizer_->solve(near_trajectory, 1 - optimizer_params_.weight);
+    const std::vector<Eigen::Vector2d> near_points = near_trajectory->getControlPoints();
+    // Controllers reading the trajectory buffer or the ring only ever see full horizons
+    const spline::CubicBSpline near_spline(near_points);
+
+    std::vector<Eigen::Vector2d> opt_points;
+    std::vector<double> optimized_curvatures;
+    for (double u = 0.0; u <= 1.0; u += 0.01) {
+        opt_points.push_back(near_spline.evaluateSpline(u, 0));
+        optimized_curvatures.push_back(near_spline.computeCurvature(u));
+    }
+    if (acceptTrajectory(opt_points, optimized_curvatures, true)) {
+        publishTrajectory(opt_points, optimized_curvatures, true);
+        publishSpline(near_points, true);
+    }
+    diagnostics_.recordStage(NodeDiagnostics::NearHorizon, (ros::WallTime::now() - near_start).toSec());
+    // Both problems share the reference points, but the window's normals differ from those of the full
+    // horizon, so the displacements are handed over and the full horizon projects them onto its own normals.
+    // The end point of the window only saw a shrunk corridor, the full horizon places it again.
+    const Eigen::VectorXd& offsets = near_optimizer_->getSolution();
+    return (near_optimizer_->getNormalVectors().topRows(num_near - 1).array().colwise() * offsets.head(num_near - 1).array()).matrix();
+}
+
+// Publish the optimized path and its curvature
+void RosWrapper::publishTrajectory(const std::vector<Eigen::Vector2d>& opt_points, const std::vector<double>& opt_curv,
+                                   const bool near_horizon) {
+    // Publish the optimized path, stamped with the input it was computed from
     nav_msgs::Path opt_path;
-    opt_path.header.stamp = ros::Time::now();
+    opt_path.header.stamp = boundaries_time_;
     opt_path.header.frame_id = frames_.world;
     for (const auto& point : opt_points) {
         geometry_msgs::PoseStamped pose;
@@ -147,7 +726,80 @@ void RosWrapper::publish(const std::vector<Eigen::Vector2d>& opt_points,
         pose.pose.position.y = point.y();
         opt_path.poses.push_back(pose);
     }
-    pub_.optimized_path.publish(opt_path);
+    (near_horizon ? pub_.near_horizon_path : pub_.optimized_path).publish(opt_path);
+
+    // Publish the optimized curvatures
+    std_msgs::Float64MultiArray curv_opt_msg;
+    for (std::size_t i = 0; i < opt_curv.size(); ++i) {
+        curv_opt_msg.data.push_back(opt_curv[i]);
+    }
+    (near_horizon ? pub_.near_horizon_curvature : pub_.optimized_curvature).publish(curv_opt_msg);
+
+    // The topics carry the magnitude, the ring is signed like the trajectory buffer
+    if (trajectory_ring_ && !near_horizon) {
+        trajectory_ring_->write(opt_points, signedCurvature(opt_points, opt_curv), boundaries_time_.toSec());
+    }
+}
+
+// The in-process trajectory buffer is always updated, the filter only saves the topics and the ring
+const bool RosWrapper::acceptTrajectory(const std::vector<Eigen::Vector2d>& opt_points, const std::vector<double>& opt_curv,
+                                        const bool near_horizon) {
+    PublishFilter* filter = near_horizon ? near_publish_filter_.get() : publish_filter_.get();
+    if (!filter) {
+        return true;
+    }
+    const char* stream = near_horizon ? "Near-horizon trajectory" : "Trajectory";
+    const bool accepted = filter->accept(opt_points, opt_curv);
+    const auto& change = filter->getLastChange();
+    ROS_DEBUG("[min_curv_ros_wrapper] %s moved by %.4f m, curvature by %.5f 1/m, length by %.4f m, %s.", stream,
+              change.deviation, change.curvature_change, change.length_change, accepted ? "publishing" : "suppressed");
+    const std::size_t total = filter->getAccepted() + filter->getSuppressed();
+    ROS_INFO_THROTTLE(10.0, "[min_curv_ros_wrapper] Publish filter suppressed %.1f%% of %s (%zu of %zu).",
+                      100.0 * filter->getSuppressed() / total, near_horizon ? "near-horizon windows" : "trajectories",
+                      filter->getSuppressed(), total);
+    return accepted;
+}
+
+// Publish the optimized B-spline itself, a fraction of the size of the sampled path
+void RosWrapper::publishSpline(const std::vector<Eigen::Vector2d>& control_points, const bool near_horizon) {
+    // A cubic needs four control points, shorter near-horizon windows only go out as paths
+    if (control_points.size() < 4) {
+        return;
+    }
+    min_curv_msgs::BSplineTrajectory spline_msg;
+    spline_msg.header.stamp = boundaries_time_;
+    spline_msg.header.frame_id = frames_.world;
+    spline_msg.x.reserve(control_points.size());
+    spline_msg.y.reserve(control_points.size());
+    for (const auto& point : control_points) {
+        spline_msg.x.push_back(point.x());
+        spline_msg.y.push_back(point.y());
+    }
+    // Same resolution as the sampled path, but up to the end point
+    const spline::BSplineEvaluator evaluator(control_points);
+    constexpr std::size_t num_samples = 101;
+    spline_msg.length = 0.0;
+    spline_msg.max_curvature = 0.0;
+    Eigen::Vector2d previous = evaluator.evaluate(0.0);
+    for (std::size_t i = 0; i < num_samples; ++i) {
+        const double u = static_cast<double>(i) / (num_samples - 1);
+        const Eigen::Vector2d point = evaluator.evaluate(u);
+        spline_msg.length += (point - previous).norm();
+        spline_msg.max_curvature = std::max(spline_msg.max_curvature, std::abs(evaluator.curvature(u)));
+        previous = point;
+    }
+    spline_msg.near_horizon = near_horizon;
+    pub_.optimized_spline.publish(spline_msg);
+}
+
+// Function to publish the optimized path and curvatures
+void RosWrapper::publish(const std::vector<Eigen::Vector2d>& opt_points,
+                         const std::vector<Eigen::Vector2d>& left_boundary,
+                         const std::vector<Eigen::Vector2d>& right_boundary,
+                         const std::vector<double>& init_curv,
+                         const std::vector<double>& opt_curv) {
+    const ros::WallTime publishing_start = ros::WallTime::now();
+    publishTrajectory(opt_points, opt_curv, false);
 
     // Publish boundaries
     nav_msgs::Path left_boundary_path;
@@ -179,13 +831,8 @@ void RosWrapper::publish(const std::vector<Eigen::Vector2d>& opt_points,
     }
     pub_.initial_curvature.publish(curv_init_msg);
 
-    // Publish the optimized curvatures
-    std_msgs::Float64MultiArray curv_opt_msg;
-    for (std::size_t i = 0; i < opt_curv.size(); ++i) {
-        curv_opt_msg.data.push_back(opt_curv[i]);
-    }
-    pub_.optimized_curvature.publish(curv_opt_msg);
-
+    diagnostics_.recordStage(NodeDiagnostics::Publishing, (ros::WallTime::now() - publishing_start).toSec());
+    diagnostics_.recordEndToEnd(boundaries_time_);
     ROS_INFO("[min_curv_ros_wrapper] Optimized path and curvature have been published.");
 }
 